@@ -1,4 +1,7 @@
 #include "Frameless.h"
+#include "FramelessChannel.h"
+#include "FramelessLogging.h"
+#include "FramelessScreenTopology.h"
 #include "FramelessWorker.h"
 #include "FramelessWorkerEvent.h"
 #include "AppGlobalInfo.h"
@@ -6,11 +9,15 @@
 
 #include <QWidget>
 #include <QWindow>
+#include <QLayout>
 #include <QMouseEvent>
 #include <QRect>
 #include <QDebug>
 #include <QApplication>
+#include <QScreen>
+#include <QThread>
 #include <QTimer>
+#include <QtMath>
 
 #ifdef Q_OS_WINDOWS
 #include <dwmapi.h>
@@ -19,48 +26,109 @@
 
 #define FREMELESS_BORDER 6
 
-Frameless::Frameless(QWidget *self, QObject *parent)
+Q_LOGGING_CATEGORY(lcFrameless, "frameless")
+
+namespace {
+
+// every live Frameless, only touched on the GUI thread
+QVector<Frameless *> &framelessInstances()
+{
+    static QVector<Frameless *> instances;
+    return instances;
+}
+
+}
+
+Frameless::Frameless(QWidget *self, QObject *parent, ExecutionPolicy policy)
     : QObject(parent)
     , mSelf(self)
-    , mWorker(FramelessWorker::instance())
+    , mPolicy(policy)
+    , mWorker(policy == ExecutionPolicy::SharedWorker ? FramelessWorker::poolWorker() : new FramelessWorker(this))
+    , mChannel(mWorker->registerFrameless(this))
     , mCanWindowMove(false)
     , mCanWindowResize(false)
-    , mDir(Direction::None)
-    , mLeftButtonPress(false)
     , mAlreadyChangeCursor(false)
-    , mCurrentCanWindowMove(false)
     , mOverrideCursorShape(Qt::ArrowCursor)
+    , mBorderMargins(FREMELESS_BORDER, FREMELESS_BORDER, FREMELESS_BORDER, FREMELESS_BORDER)
+    , mCornerExtent(FREMELESS_BORDER)
+    , mCommitTimer(new QTimer(this))
 {
+    mCommitTimer->setSingleShot(true);
+    mCommitTimer->setTimerType(Qt::PreciseTimer);
+    connect(mCommitTimer, &QTimer::timeout, this, &Frameless::commitGeometry);
+
+    // queued, a removed screen is still being torn down while Qt reports it
+    connect(FramelessScreenTopology::instance(), &FramelessScreenTopology::changed,
+            this, &Frameless::publishGeometry, Qt::QueuedConnection);
+
+    setDirection(Direction::None);
+    mInputClock.start();
+    framelessInstances().append(this);
+
     mSelf->setWindowFlags(mSelf->windowFlags() | Qt::FramelessWindowHint);
     mSelf->setAttribute(Qt::WA_TranslucentBackground, MachineHelper::canUseCompositing());
     setCanWindowResize(true);
-    mWorker->start();
+    publishGeometry();
+
+    // an inline worker is never started, events run through it synchronously
+    if (mPolicy != ExecutionPolicy::Inline)
+        mWorker->start();
+}
+
+Frameless::~Frameless()
+{
+    framelessInstances().removeOne(this);
+    mWorker->unregisterFrameless(mChannel);
+
+    if (mPolicy == ExecutionPolicy::DedicatedWorker)
+        mWorker->exit();
+}
+
+Frameless::ExecutionPolicy Frameless::executionPolicy() const
+{
+    return mPolicy;
+}
+
+void Frameless::setStateBits(quint32 mask, quint32 value)
+{
+    quint32 current = mShared.bits.loadRelaxed();
+    while (!mShared.bits.testAndSetRelease(current, (current & ~mask) | (value & mask), current)) {
+    }
+}
+
+bool Frameless::testStateBit(StateBits bit) const
+{
+    return mShared.bits.loadAcquire() & bit;
 }
 
 void Frameless::setDirection(Direction dir)
 {
-    mDir = dir;
+    setStateBits(DirectionMask, quint32(int(dir) + 1));
 }
 
 Frameless::Direction Frameless::direction() const
 {
-    return mDir;
+    return static_cast<Direction>(int(mShared.bits.loadAcquire() & DirectionMask) - 1);
 }
 
 void Frameless::setCurrentCanWindowMove(bool canWindowMove)
 {
-    mCurrentCanWindowMove = canWindowMove;
+    setStateBits(CurrentCanWindowMove, canWindowMove ? CurrentCanWindowMove : 0);
 }
 
 bool Frameless::currentCanWindowMove() const
 {
-    return mCurrentCanWindowMove;
+    return testStateBit(CurrentCanWindowMove);
 }
 
 void Frameless::setCanWindowMove(bool canMove)
 {
-    qInfo() << "+++!!!000111222333" << canMove;
+    if (mCanWindowMove == canMove)
+        return;
+
+    qCDebugFrameless() << "can window move" << canMove;
     mCanWindowMove = canMove;
+    Q_EMIT canWindowMoveChanged(canMove);
 }
 
 bool Frameless::canWindowMove() const
@@ -82,58 +150,293 @@ bool Frameless::canWindowResize() const
     return mCanWindowResize;
 }
 
+void Frameless::addCaptionRect(const QRect &rect)
+{
+    mCaptionRects.append(rect);
+    mHitMapDirty = true;
+    publishGeometry();
+}
+
+void Frameless::addCaptionWidget(QWidget *widget)
+{
+    // the map is in window coordinates, only our own children can map into it
+    if (!widget || !mSelf->isAncestorOf(widget)) {
+        qCWarning(lcFrameless) << "Frameless: the caption widget" << widget << "is not a child of" << mSelf;
+        return;
+    }
+
+    mCaptionWidgets.append(widget);
+    watchHitMapWidget(widget);
+    mHitMapDirty = true;
+    publishGeometry();
+}
+
+void Frameless::addExcludedWidget(QWidget *widget)
+{
+    if (!widget || !mSelf->isAncestorOf(widget)) {
+        qCWarning(lcFrameless) << "Frameless: the excluded widget" << widget << "is not a child of" << mSelf;
+        return;
+    }
+
+    mExcludedWidgets.append(widget);
+    watchHitMapWidget(widget);
+    mHitMapDirty = true;
+    publishGeometry();
+}
+
+void Frameless::clearHitMap()
+{
+    for (const QPointer<QWidget> &widget : qAsConst(mHitMapWatched)) {
+        if (widget)
+            widget->removeEventFilter(this);
+    }
+
+    mCaptionRects.clear();
+    mCaptionWidgets.clear();
+    mExcludedWidgets.clear();
+    mHitMapWatched.clear();
+    mHitMapDirty = true;
+    publishGeometry();
+}
+
+bool Frameless::hasHitMap() const
+{
+    return hasCaptions() || !mExcludedWidgets.isEmpty();
+}
+
+bool Frameless::hasCaptions() const
+{
+    return !mCaptionRects.isEmpty() || !mCaptionWidgets.isEmpty();
+}
+
+void Frameless::watchHitMapWidget(QWidget *widget)
+{
+    // a container moving or resizing moves the widget inside it without a
+    // Move of its own, so every parent up to the window is watched as well;
+    // the window itself reaches us through targetEvent
+    for (QWidget *parent = widget; parent && parent != mSelf; parent = parent->parentWidget()) {
+        if (mHitMapWatched.contains(parent))
+            continue;
+
+        parent->installEventFilter(this);
+        mHitMapWatched.append(parent);
+    }
+}
+
+bool Frameless::eventFilter(QObject *watched, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::Move:
+    case QEvent::Resize:
+    case QEvent::Show:
+    case QEvent::Hide:
+        // rebuilt once by the next publish, a press always publishes
+        mHitMapDirty = true;
+        break;
+    default:
+        break;
+    }
+
+    return QObject::eventFilter(watched, event);
+}
+
+void Frameless::rebuildHitMap()
+{
+    mHitMapDirty = false;
+    if (!hasHitMap()) {
+        mHitMap.reset();
+        return;
+    }
+
+    QSharedPointer<FramelessHitMap> hitMap(new FramelessHitMap(hasCaptions()));
+    for (const QRect &rect : qAsConst(mCaptionRects))
+        hitMap->addCaption(rect);
+
+    for (const QPointer<QWidget> &widget : qAsConst(mCaptionWidgets)) {
+        if (widget && widget->isVisible())
+            hitMap->addCaption(QRect(widget->mapTo(mSelf, QPoint(0, 0)), widget->size()));
+    }
+
+    for (const QPointer<QWidget> &widget : qAsConst(mExcludedWidgets)) {
+        if (widget && widget->isVisible())
+            hitMap->addExcluded(QRect(widget->mapTo(mSelf, QPoint(0, 0)), widget->size()));
+    }
+
+    mHitMap = hitMap;
+}
+
+bool Frameless::canWindowMoveAt(const QPoint &pos) const
+{
+    return mHitMap ? mHitMap->isCaption(pos, mCanWindowMove) : mCanWindowMove;
+}
+
 int Frameless::framelessBorder() const
 {
-    return FREMELESS_BORDER;
+    if (mBorderScale <= 0)
+        return qMax(qMax(mBorderMargins.left(), mBorderMargins.right()), qMax(mBorderMargins.top(), mBorderMargins.bottom()));
+
+    return qMax(qMax(mScaledBorder.left(), mScaledBorder.right()), qMax(mScaledBorder.top(), mScaledBorder.bottom()));
+}
+
+void Frameless::setBorderMargins(const QMargins &margins, int cornerExtent)
+{
+    mBorderMargins = margins;
+    mBorderScale = 0;
+    mCornerExtent = cornerExtent < 0 ? framelessBorder() : cornerExtent;
+    publishGeometry();
+}
+
+QMargins Frameless::borderMargins() const
+{
+    return mBorderMargins;
+}
+
+int Frameless::cornerExtent() const
+{
+    return mCornerExtent;
+}
+
+qreal Frameless::borderScale() const
+{
+    // logical pixels already follow the device pixel ratio, the dpi carries
+    // whatever scaling the platform applies on top of it
+    QWindow *window = mSelf->window()->windowHandle();
+    QScreen *screen = window ? window->screen() : QGuiApplication::primaryScreen();
+    const FramelessScreenInfo *info = FramelessScreenTopology::instance()->screenInfo(screen);
+
+    return info ? qMax<qreal>(info->logicalDpi / 96, 1) : 1;
 }
 
 void Frameless::setDragPosition(const QPoint &dragPosition)
 {
-    mDragPosition = dragPosition;
+    // both coordinates in one word, a reader never sees a torn point
+    mShared.dragPosition.storeRelease(quint64(quint32(dragPosition.x())) << 32 | quint32(dragPosition.y()));
 }
 
 QPoint Frameless::dragPosition() const
 {
-    return mDragPosition;
+    const quint64 packed = mShared.dragPosition.loadAcquire();
+    return QPoint(qint32(quint32(packed >> 32)), qint32(quint32(packed)));
 }
 
 void Frameless::setLeftMouseButtonPressed(bool pressed)
 {
-    mLeftButtonPress = pressed;
+    setStateBits(LeftButtonPressed, pressed ? LeftButtonPressed : 0);
 }
 
 bool Frameless::leftMouseButtonPressed() const
 {
-    return mLeftButtonPress;
+    return testStateBit(LeftButtonPressed);
 }
 
 void Frameless::setAcceptSystemResize(bool accept)
 {
-    mAcceptSystemResize = accept;
+    setStateBits(AcceptSystemResize, accept ? AcceptSystemResize : 0);
 }
 
 bool Frameless::acceptSystemResize() const
 {
-    return mAcceptSystemResize;
+    return testStateBit(AcceptSystemResize);
 }
 
 void Frameless::setAcceptSystemMoving(bool accept)
 {
-    mAcceptSystemMoving = accept;
+    setStateBits(AcceptSystemMoving, accept ? AcceptSystemMoving : 0);
 }
 
 bool Frameless::acceptSystemMoving() const
 {
-    return mAcceptSystemMoving;
+    return testStateBit(AcceptSystemMoving);
+}
+
+void Frameless::setGeometryCommitMode(CommitMode mode)
+{
+    if (mCommitMode == mode)
+        return;
+
+    mCommitMode = mode;
+    if (mCommitMode == CommitMode::Immediate && mHasPendingGeometry) {
+        mCommitTimer->stop();
+        commitGeometry();
+    }
+}
+
+void Frameless::setDragPrediction(int horizonMs, int clamp)
+{
+    mPredictionHorizon = qMax(0, horizonMs);
+    mPredictionClamp = qMax(0, clamp);
+    publishGeometry();
+}
+
+int Frameless::dragPredictionHorizon() const
+{
+    return mPredictionHorizon;
+}
+
+void Frameless::setSnapping(int threshold, bool tiling)
+{
+    mSnapThreshold = qMax(0, threshold);
+    mWindowTiling = tiling;
+    if (mSnapThreshold == 0)
+        mSnapIndex.reset();
+
+    publishGeometry();
+}
+
+int Frameless::snapThreshold() const
+{
+    return mSnapThreshold;
+}
+
+quint64 Frameless::geometryCommitCount() const
+{
+    return mGeometryCommitCount;
+}
+
+bool Frameless::isInteractiveMoveResize() const
+{
+    return mInteractiveMoveResize;
+}
+
+Frameless::CommitMode Frameless::geometryCommitMode() const
+{
+    return mCommitMode;
 }
 
 void Frameless::targetEvent(QEvent *event)
 {
+    FRAMELESS_STATS(const qint64 inputNs = FramelessStats::now());
+    finishSystemMoveResize(event);
+
     FramelessEvent *framelessEvent = nullptr;
     switch (event->type()) {
+    case QEvent::Move:
+    case QEvent::Resize:
+    case QEvent::Show:
+    case QEvent::WindowStateChange:
+    case QEvent::LayoutRequest:
+        // only a move leaves the registered children where they were
+        if (event->type() != QEvent::Move && hasHitMap())
+            mHitMapDirty = true;
+
+        // xcb applies the un-maximize asynchronously and the window manager
+        // would put its own restore geometry over a rect set in the same turn
+        if (event->type() == QEvent::WindowStateChange && mHasPendingRestore && !mSelf->isMaximized())
+            QMetaObject::invokeMethod(this, &Frameless::applyPendingRestore, Qt::QueuedConnection);
+        publishGeometry();
+        break;
     case QEvent::HoverMove: {
-        FramelessMouseHoverEvent *mouseHoverEvent = new FramelessMouseHoverEvent();
-        mouseHoverEvent->globalCursorPositon = mSelf->mapToGlobal(static_cast<QHoverEvent *>(event)->pos());
+        // the previous hover already left the cursor alone in here
+        const QPoint &pos = static_cast<QHoverEvent *>(event)->pos();
+        const bool inside = mInnerSafeRect.contains(pos);
+        if (inside && mLastHoverInside) {
+            event->accept();
+            break;
+        }
+        mLastHoverInside = inside;
+
+        FramelessMouseHoverEvent *mouseHoverEvent = mChannel->acquireEvent<FramelessMouseHoverEvent>();
+        mouseHoverEvent->globalCursorPositon = mSelf->mapToGlobal(pos);
         mouseHoverEvent->canWindowResize = mCanWindowResize;
         framelessEvent = mouseHoverEvent;
 
@@ -145,35 +448,61 @@ void Frameless::targetEvent(QEvent *event)
         if (mouseEvent->button() != Qt::LeftButton)
             break;
 
-        FramelessMousePressEvent *mousePressEvent = new FramelessMousePressEvent();
+        if (mSnapThreshold > 0)
+            rebuildSnapIndex();
+        publishGeometry();
+
+        FramelessMousePressEvent *mousePressEvent = mChannel->acquireEvent<FramelessMousePressEvent>();
         mousePressEvent->globalCursorPositon = mouseEvent->globalPos();
-        qInfo() << "targetEvent............." << mCanWindowMove;
+        qCDebugFrameless() << "press" << mousePressEvent->globalCursorPositon << "can window move" << mCanWindowMove;
         mousePressEvent->canWindowMove = mCanWindowMove;
         framelessEvent = mousePressEvent;
 
+        mouseEvent->accept();
+    }
+        break;
+    case QEvent::MouseButtonDblClick: {
+        // a double click on the caption toggles maximized
+        QMouseEvent *mouseEvent = static_cast<QMouseEvent *>(event);
+        if (mHitMapDirty)
+            rebuildHitMap();
+        if (mouseEvent->button() != Qt::LeftButton || !canWindowMoveAt(mouseEvent->pos())
+                || direction() != Direction::None || !mSelf->isWindow() || mSelf->isFullScreen())
+            break;
+
+        if (mSelf->isMaximized()) {
+            mSelf->showNormal();
+        } else {
+            mSelf->showMaximized();
+        }
         mouseEvent->accept();
     }
         break;
     case QEvent::MouseButtonRelease: {
-        FramelessMouseReleaseEvent *mouseReleaseEvent = new FramelessMouseReleaseEvent();
+        mSystemMoveResizeActive = false;
+
+        FramelessMouseReleaseEvent *mouseReleaseEvent = mChannel->acquireEvent<FramelessMouseReleaseEvent>();
+        mouseReleaseEvent->globalCursorPositon = QCursor::pos();
         framelessEvent = mouseReleaseEvent;
     }
         break;
     case QEvent::MouseMove: {
-        FramelessMouseMoveEvent *mouseMoveEvent = new FramelessMouseMoveEvent();
+        FramelessMouseMoveEvent *mouseMoveEvent = mChannel->acquireEvent<FramelessMouseMoveEvent>();
         mouseMoveEvent->canWindowResize = mCanWindowResize;
         mouseMoveEvent->globalCursorPositon = static_cast<QMouseEvent *>(event)->globalPos();
+        mouseMoveEvent->timestamp = mInputClock.nsecsElapsed() / 1000;
 
         framelessEvent = mouseMoveEvent;
     }
         break;
     case QEvent::Leave: {
-        FramelessLeaveEvent *leave = new FramelessLeaveEvent();
+        FramelessLeaveEvent *leave = mChannel->acquireEvent<FramelessLeaveEvent>();
         framelessEvent = leave;
     }
         break;
     case QEvent::FocusIn: {
-        FramelessFocusInEvent *focusInEvent = new FramelessFocusInEvent();
+        FramelessFocusInEvent *focusInEvent = mChannel->acquireEvent<FramelessFocusInEvent>();
+        focusInEvent->globalCursorPositon = QCursor::pos();
         focusInEvent->canWindowResize = mCanWindowResize;
         framelessEvent = focusInEvent;
     }
@@ -187,21 +516,303 @@ void Frameless::targetEvent(QEvent *event)
     }
 
     if (framelessEvent) {
+        if (framelessEvent->type() != FramelessEvent::MouseHover)
+            mLastHoverInside = false;
+
         framelessEvent->target = mSelf;
         framelessEvent->frameless = this;
+        framelessEvent->channel = mChannel;
+        FRAMELESS_STATS(framelessEvent->inputNs = inputNs);
 
-        mWorker->postEvent(framelessEvent);
+        if (mPolicy == ExecutionPolicy::Inline) {
+            mWorker->sendEvent(mChannel, framelessEvent);
+        } else {
+            mWorker->postEvent(mChannel, framelessEvent);
+        }
+    }
+}
+
+void Frameless::finishSystemMoveResize(QEvent *event)
+{
+    if (!mSystemMoveResizeActive)
+        return;
+
+    switch (event->type()) {
+    case QEvent::Enter:
+    case QEvent::HoverEnter:
+    case QEvent::HoverMove:
+    case QEvent::MouseMove:
+        break;
+    default:
+        return;
+    }
+
+    // the window manager swallowed the button release of its move/resize
+    if (QGuiApplication::mouseButtons() & Qt::LeftButton)
+        return;
+
+    QMouseEvent release(QEvent::MouseButtonRelease, QPointF(), QPointF(), QPointF(),
+                        Qt::LeftButton, Qt::NoButton, Qt::NoModifier);
+    targetEvent(&release);
+}
+
+void Frameless::publishGeometry()
+{
+    FramelessGeometry geometry;
+
+    const QRect &rect = mSelf->frameGeometry();
+    QPoint tl = rect.topLeft();
+    QPoint rb = rect.bottomRight();
+
+    QWidget *window = mSelf->window();
+    geometry.isWindow = (window == mSelf);
+    if (window && window != mSelf) {
+        tl = mSelf->mapTo(window, mSelf->mapFromGlobal(tl));
+        rb = mSelf->mapTo(window, mSelf->mapFromGlobal(rb));
+        geometry.globalOffset = mSelf->mapTo(window, QPoint(0, 0)) - mSelf->mapToGlobal(QPoint(0, 0));
+    }
+
+    geometry.originRect = QRect(tl, rb);
+    geometry.frameTopLeft = rect.topLeft();
+    geometry.clientOrigin = mSelf->mapToGlobal(QPoint(0, 0));
+    geometry.minimumSize = mSelf->minimumSize();
+    geometry.maximumSize = mSelf->maximumSize();
+    geometry.layoutMargin = mSelf->layout() ? mSelf->layout()->margin() : 0;
+
+    const qreal scale = borderScale();
+    if (!qFuzzyCompare(scale, mBorderScale)) {
+        mBorderScale = scale;
+        mScaledBorder = QMargins(qRound(mBorderMargins.left() * scale), qRound(mBorderMargins.top() * scale),
+                                 qRound(mBorderMargins.right() * scale), qRound(mBorderMargins.bottom() * scale));
+        mScaledCornerExtent = qRound(mCornerExtent * scale);
+    }
+    geometry.border = mScaledBorder;
+    geometry.cornerExtent = mScaledCornerExtent;
+    geometry.windowState = mSelf->windowState();
+    geometry.normalGeometry = mSelf->normalGeometry();
+    if (!geometry.isMaximized() && !geometry.isFullScreen())
+        mNormalLayoutMargin = geometry.layoutMargin;
+    geometry.normalLayoutMargin = mNormalLayoutMargin;
+    geometry.predictionHorizon = mPredictionHorizon;
+    geometry.predictionClamp = mPredictionClamp;
+    for (const FramelessScreenInfo &screen : FramelessScreenTopology::instance()->screens())
+        geometry.screens.append(screen);
+    geometry.snapThreshold = mSnapThreshold;
+    geometry.windowTiling = mWindowTiling;
+    geometry.snapIndex = mSnapIndex;
+
+    if (mHitMapDirty)
+        rebuildHitMap();
+    geometry.hitMap = mHitMap;
+
+    mChannel->geometry.publish(geometry);
+
+    // shrink by one more pixel, the top-right corner test uses closed bounds
+    const int inset = geometry.layoutMargin + 1;
+    mInnerSafeRect = geometry.originRect.adjusted(inset + mScaledBorder.left(), inset + mScaledBorder.top(),
+                                                  -inset - mScaledBorder.right(), -inset - mScaledBorder.bottom());
+    mInnerSafeRect.translate(-geometry.mapFromGlobal(mSelf->mapToGlobal(QPoint(0, 0))));
+}
+
+void Frameless::rebuildSnapIndex()
+{
+    // once per drag, the worker then snaps every move with a binary search
+    QSharedPointer<FramelessSnapIndex> index(new FramelessSnapIndex);
+    for (const FramelessScreenInfo &screen : FramelessScreenTopology::instance()->screens())
+        index->addRect(screen.availableGeometry);
+
+    for (const Frameless *frameless : qAsConst(framelessInstances())) {
+        const QWidget *widget = frameless->mSelf;
+        if (frameless == this || !widget->isWindow() || !widget->isVisible() || widget->isMinimized())
+            continue;
+
+        const int margin = widget->layout() ? widget->layout()->margin() : 0;
+        index->addRect(widget->frameGeometry().adjusted(margin, margin, -margin, -margin));
+    }
+
+    index->finalize();
+    mSnapIndex = index;
+}
+
+void Frameless::drainCommands()
+{
+    // clear first, a command pushed after this will schedule another drain
+    mChannel->drainScheduled.fetchAndStoreOrdered(0);
+
+    FramelessCommand command;
+    while (mChannel->commands.pop(command))
+        applyCommand(command);
+}
+
+void Frameless::waitForWorker()
+{
+    // the worker clears scheduled only after the batch and its commands are
+    // flushed, and we are the only producer, so an empty idle channel stays so.
+    // Commands a full ring held back keep the channel scheduled until we drain it
+    while ((mChannel->scheduled.loadAcquire() || !mChannel->events.isEmpty()) && mWorker->isRunning()) {
+        drainCommands();
+        QThread::yieldCurrentThread();
+    }
+
+    drainCommands();
+    if (mHasPendingGeometry) {
+        mCommitTimer->stop();
+        commitGeometry();
+    }
+}
+
+void Frameless::applyCommand(const FramelessCommand &command)
+{
+    switch (command.type) {
+    case FramelessCommand::Move:
+        FRAMELESS_STATS(mPendingInputNs = command.inputNs);
+        moveByFrameless(command.pos);
+        break;
+
+    case FramelessCommand::SetGeometry:
+        FRAMELESS_STATS(mPendingInputNs = command.inputNs);
+        setGeometryByFrameless(command.rect);
+        break;
+
+    case FramelessCommand::SetCursor:
+        setCursorByFrameless(command.cursorShape);
+        break;
+
+    case FramelessCommand::UnsetCursor:
+        unsetCursorByFrameless();
+        break;
+
+    case FramelessCommand::StartMove:
+        beginInteractiveMoveResize(false);
+        readyToStartMove(command.cursorShape);
+        break;
+
+    case FramelessCommand::StartResize:
+        // listeners read acceptSystemResize() to tell a native resize apart
+        accpetSystemResize();
+        beginInteractiveMoveResize(true);
+        mSelf->releaseMouse();
+        break;
+
+    case FramelessCommand::FinishMoveResize:
+        // a StartMove drained after the worker saw the release set these again
+        setAcceptSystemMoving(false);
+        setAcceptSystemResize(false);
+        endInteractiveMoveResize();
+        break;
+
+    case FramelessCommand::Restore:
+        beginInteractiveMoveResize(false);
+        restoreByFrameless(command.rect);
+        break;
+
+    default:
+        break;
     }
 }
 
 void Frameless::moveByFrameless(const QPoint &pos)
 {
-    mSelf->move(pos);
+    // moves racing the restore carry the restored rect along, it stays one commit
+    if (mHasPendingRestore) {
+        mPendingRestore.moveTopLeft(pos);
+        return;
+    }
+
+    // a resize still waiting for its frame keeps its size and takes the position
+    if (!mHasPendingGeometry)
+        mPendingMove = true;
+
+    mPendingGeometry.moveTopLeft(pos);
+    scheduleGeometryCommit();
 }
 
 void Frameless::setGeometryByFrameless(const QRect &rect)
 {
-    mSelf->setGeometry(rect);
+    if (mHasPendingRestore) {
+        mPendingRestore = rect;
+        return;
+    }
+
+    mPendingGeometry = rect;
+    mPendingMove = false;
+    scheduleGeometryCommit();
+}
+
+void Frameless::scheduleGeometryCommit()
+{
+    mHasPendingGeometry = true;
+    if (mCommitMode == CommitMode::Immediate)
+        return commitGeometry();
+
+    if (mCommitTimer->isActive())
+        return;
+
+    // commit right away when the last commit is a frame old, otherwise hold
+    // the latest rect until the next refresh; rounding the wait up keeps it
+    // at one commit per frame at rates that are no whole millisecond
+    const qint64 interval = frameInterval();
+    const qint64 elapsed = mCommitClock.isValid() ? mCommitClock.nsecsElapsed() : interval;
+    if (elapsed >= interval)
+        return commitGeometry();
+
+    mCommitTimer->start(qCeil((interval - elapsed) / 1000000.0));
+}
+
+void Frameless::commitGeometry()
+{
+    if (!mHasPendingGeometry)
+        return;
+
+    mHasPendingGeometry = false;
+    mCommitClock.restart();
+    ++mGeometryCommitCount;
+
+    if (mPendingMove) {
+        mSelf->move(mPendingGeometry.topLeft());
+    } else {
+        mSelf->setGeometry(mPendingGeometry);
+    }
+
+    FRAMELESS_STATS(FramelessStats::recordStage(FramelessStats::Apply, mPendingInputNs, FramelessStats::now()));
+}
+
+void Frameless::beginInteractiveMoveResize(bool resizing)
+{
+    if (mInteractiveMoveResize)
+        return;
+
+    mInteractiveMoveResize = true;
+    Q_EMIT interactiveMoveResizeStarted(resizing);
+}
+
+void Frameless::endInteractiveMoveResize()
+{
+    // a state change that never came must not hold back the restored rect
+    applyPendingRestore();
+
+    if (!mInteractiveMoveResize)
+        return;
+
+    // the last rect of the drag lands before listeners restore full quality
+    if (mHasPendingGeometry) {
+        mCommitTimer->stop();
+        commitGeometry();
+    }
+
+    mInteractiveMoveResize = false;
+    Q_EMIT interactiveMoveResizeFinished();
+}
+
+qint64 Frameless::frameInterval() const
+{
+    QWindow *window = mSelf->window()->windowHandle();
+    QScreen *screen = window ? window->screen() : QGuiApplication::primaryScreen();
+    const FramelessScreenInfo *info = FramelessScreenTopology::instance()->screenInfo(screen);
+    const qreal refreshRate = info ? info->refreshRate : 60;
+
+    // nanoseconds, 16.67 ms at 60 Hz rather than a truncated 16
+    return qint64(1000000000 / refreshRate);
 }
 
 void Frameless::setCursorByFrameless(int shape)
@@ -242,12 +853,48 @@ void Frameless::unsetCursorByFrameless()
 void Frameless::readyToStartMove(int shape)
 {
     setAcceptSystemMoving(startSystemMove(mSelf, {0, 0}));
+    mSystemMoveResizeActive = acceptSystemMoving();
     setCursorByFrameless(shape);
 }
 
 void Frameless::accpetSystemResize()
 {
     setAcceptSystemResize(startSystemResize(mSelf, {0, 0}, static_cast<int>(direction())));
+    mSystemMoveResizeActive = acceptSystemResize();
+}
+
+void Frameless::restoreByFrameless(const QRect &rect)
+{
+    // the restore decides the geometry by itself, a pending rect is stale
+    mCommitTimer->stop();
+    mHasPendingGeometry = false;
+
+    mPendingRestore = rect;
+    mHasPendingRestore = true;
+
+    // the restored layout margin goes in before the un-maximize, so changeEvent
+    // finds the layout as it stays and the rect, set once the state change has
+    // been seen (see targetEvent), is the only commit
+    if (mSelf->isMaximized()) {
+        if (QLayout *layout = mSelf->layout())
+            layout->setMargin(mNormalLayoutMargin);
+        mSelf->setWindowState(mSelf->windowState() & ~Qt::WindowMaximized);
+        return;
+    }
+
+    applyPendingRestore();
+}
+
+void Frameless::applyPendingRestore()
+{
+    if (!mHasPendingRestore)
+        return;
+
+    mHasPendingRestore = false;
+    mCommitClock.restart();
+    ++mGeometryCommitCount;
+
+    mSelf->setGeometry(mPendingRestore);
 }
 
 #ifdef Q_OS_WIN
@@ -276,6 +923,32 @@ static inline DWORD directionToWinOrientation(int dir)
 
     return 0;
 }
+#elif defined(Q_OS_LINUX) && QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+static inline Qt::Edges directionToEdges(int dir)
+{
+    switch (static_cast<Frameless::Direction>(dir)) {
+    case Frameless::Direction::Left:
+        return Qt::LeftEdge;
+    case Frameless::Direction::Right:
+        return Qt::RightEdge;
+    case Frameless::Direction::Up:
+        return Qt::TopEdge;
+    case Frameless::Direction::TopLeft:
+        return Qt::TopEdge | Qt::LeftEdge;
+    case Frameless::Direction::TopRight:
+        return Qt::TopEdge | Qt::RightEdge;
+    case Frameless::Direction::Down:
+        return Qt::BottomEdge;
+    case Frameless::Direction::BottomLeft:
+        return Qt::BottomEdge | Qt::LeftEdge;
+    case Frameless::Direction::BottomRight:
+        return Qt::BottomEdge | Qt::RightEdge;
+    default:
+        break;
+    }
+
+    return Qt::Edges();
+}
 #endif
 
 bool Frameless::startSystemResize(QWidget *window, const QPoint &, int dir)
@@ -298,6 +971,13 @@ bool Frameless::startSystemResize(QWidget *window, const QPoint &, int dir)
     DWORD ori = directionToWinOrientation(dir);
     PostMessage(hwnd, WM_SYSCOMMAND, ori, 0);
     return true;
+#elif defined(Q_OS_LINUX) && QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    // xcb sends _NET_WM_MOVERESIZE, wayland asks the compositor, false if refused
+    const Qt::Edges edges = directionToEdges(dir);
+    if (!edges)
+        return false;
+
+    return window->windowHandle()->startSystemResize(edges);
 #else
     return false;
 #endif
@@ -328,6 +1008,8 @@ bool Frameless::startSystemMove(QWidget *window, const QPoint &)
         PostMessage(hwnd, WM_LBUTTONUP, 0, 0);
     });
     return true;
+#elif defined(Q_OS_LINUX) && QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    return window->windowHandle()->startSystemMove();
 #else
     return false;
 #endif
@@ -335,11 +1017,13 @@ bool Frameless::startSystemMove(QWidget *window, const QPoint &)
 
 void Frameless::deactivateWindowWhenSystemMove(QWidget *window)
 {
-    HWND hwnd = reinterpret_cast<HWND>(window->windowHandle()->winId());
 #ifdef Q_OS_WINDOWS
+    HWND hwnd = reinterpret_cast<HWND>(window->windowHandle()->winId());
     if (acceptSystemMoving() && leftMouseButtonPressed()) {
         PostMessage(hwnd, WM_LBUTTONUP, 0, 0);
         PostMessage(hwnd, WM_WINDOWPOSCHANGED, 0, 0);
     }
+#else
+    Q_UNUSED(window)
 #endif
 }
@@ -1,24 +1,46 @@
 #ifndef FRAMELESS_H
 #define FRAMELESS_H
 
+#include "FramelessStats.h"
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
 #include <QEvent>
 #include <QMargins>
 #include <QObject>
 #include <QPoint>
+#include <QPointer>
 #include <QRect>
+#include <QSharedPointer>
 #include <QString>
+#include <QVector>
 
 class QEvent;
 class QWidget;
 class QMouseEvent;
 class QFocusEvent;
+class QTimer;
 class FramelessWorker;
+struct FramelessChannel;
+struct FramelessCommand;
+class FramelessSnapIndex;
+class FramelessHitMap;
 class Frameless : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit Frameless(QWidget *self, QObject *parent = nullptr);
+    enum class ExecutionPolicy {
+        Inline,
+        SharedWorker,
+        DedicatedWorker
+    };
+
+    explicit Frameless(QWidget *self, QObject *parent = nullptr,
+                       ExecutionPolicy policy = ExecutionPolicy::SharedWorker);
+    ~Frameless() override;
+
+    ExecutionPolicy executionPolicy() const;
 
     void setCanWindowMove(bool canMove);
     bool canWindowMove() const;
@@ -26,8 +48,25 @@ public:
     void setCanWindowResize(bool canResize);
     bool canWindowResize() const;
 
+    // declarative caption, registered once: a press inside a caption rect or
+    // widget and outside every excluded widget moves the window. The worker
+    // decides from the published map; canWindowMove() is only consulted while
+    // no caption is registered, and excluded widgets still apply to it.
+    void addCaptionRect(const QRect &rect);
+    void addCaptionWidget(QWidget *widget);
+    void addExcludedWidget(QWidget *widget);
+    void clearHitMap();
+    bool hasHitMap() const;
+    bool hasCaptions() const;
+
     int framelessBorder() const;
 
+    // grab width of every edge and how far the corner zones reach along
+    // the edges, in 96 dpi pixels; scaled with the screen's logical dpi
+    void setBorderMargins(const QMargins &margins, int cornerExtent = -1);
+    QMargins borderMargins() const;
+    int cornerExtent() const;
+
     enum class Direction {
         None = -1,
         Up,
@@ -60,7 +99,40 @@ public:
 
     bool framelessMoving() const;
 
+    // true between the press that starts a move/resize and its release
+    bool isInteractiveMoveResize() const;
+
+    // Immediate sets every rect the worker sends, FramePaced holds the latest
+    // one until the screen's next refresh; windows start out Immediate
+    enum class CommitMode {
+        Immediate,
+        FramePaced
+    };
+
+    void setGeometryCommitMode(CommitMode mode);
+    CommitMode geometryCommitMode() const;
+
+    // geometry actually handed to the window, commits per second under load
+    quint64 geometryCommitCount() const;
+
+    // software moves lead the pointer by its velocity over horizonMs, at
+    // most clamp pixels per axis, and snap back on release; 0 turns it off
+    void setDragPrediction(int horizonMs, int clamp = 32);
+    int dragPredictionHorizon() const;
+
+    // software moves and resizes snap to screen work areas and other
+    // frameless windows within threshold pixels, and a move released at a
+    // work area edge or corner tiles the window to a half or quarter; 0 is off
+    void setSnapping(int threshold, bool tiling = true);
+    int snapThreshold() const;
+
     void targetEvent(QEvent *event);
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    void drainCommands();
+
+    // blocks until the worker has handled everything posted so far and
+    // applies its commands, gives replays a deterministic point to check at
+    void waitForWorker();
 
     Q_INVOKABLE void moveByFrameless(const QPoint &pos);
     Q_INVOKABLE void setGeometryByFrameless(const QRect &rect);
@@ -68,8 +140,29 @@ public:
     Q_INVOKABLE void unsetCursorByFrameless();
     Q_INVOKABLE void readyToStartMove(int shape);
     Q_INVOKABLE void accpetSystemResize();
+    Q_INVOKABLE void restoreByFrameless(const QRect &rect);
+
+Q_SIGNALS:
+    void canWindowMoveChanged(bool canMove);
+    void interactiveMoveResizeStarted(bool resizing);
+    void interactiveMoveResizeFinished();
 
 private:
+    void finishSystemMoveResize(QEvent *event);
+    void publishGeometry();
+    void rebuildSnapIndex();
+    void rebuildHitMap();
+    void watchHitMapWidget(QWidget *widget);
+    bool canWindowMoveAt(const QPoint &pos) const;
+    qreal borderScale() const;
+    void applyCommand(const FramelessCommand &command);
+    void scheduleGeometryCommit();
+    void commitGeometry();
+    void applyPendingRestore();
+    void beginInteractiveMoveResize(bool resizing);
+    void endInteractiveMoveResize();
+    qint64 frameInterval() const;
+
     bool startSystemResize(QWidget *window, const QPoint &, int dir);
     bool startSystemMove(QWidget *window, const QPoint &);
     void deactivateWindowWhenSystemMove(QWidget *window);
@@ -77,19 +170,86 @@ private:
 private:
     // worker and target
     QWidget *           mSelf;
+    ExecutionPolicy     mPolicy;
     FramelessWorker *   mWorker;
+    FramelessChannel *  mChannel;
     bool                mCanWindowMove = false;
     bool                mCanWindowResize = false;
 
+    // state shared with the worker, packed into one word plus the drag
+    // position and kept on its own cache line away from GUI-only fields
+    enum StateBits : quint32 {
+        DirectionMask           = 0xf,  // Direction + 1
+        LeftButtonPressed       = 0x10,
+        AcceptSystemResize      = 0x20,
+        AcceptSystemMoving      = 0x40,
+        CurrentCanWindowMove    = 0x80
+    };
+
+    struct alignas(64) SharedState
+    {
+        QAtomicInteger<quint32> bits;
+        QAtomicInteger<quint64> dragPosition;
+    };
+
+    void setStateBits(quint32 mask, quint32 value);
+    bool testStateBit(StateBits bit) const;
+
+    SharedState         mShared;
+
     // state for window
-    QPoint              mDragPosition;
-    Direction           mDir;
-    bool                mLeftButtonPress = false;
     bool                mAlreadyChangeCursor = false;
-    bool                mCurrentCanWindowMove = false;
     int                 mOverrideCursorShape = false;
-    bool                mAcceptSystemResize = false;
-    bool                mAcceptSystemMoving = false;
+    bool                mSystemMoveResizeActive = false;
+    bool                mInteractiveMoveResize = false;
+
+    // caption map, rebuilt when a registered widget or one of its parents
+    // moves, resizes or hides
+    QVector<QRect>              mCaptionRects;
+    QVector<QPointer<QWidget>>  mCaptionWidgets;
+    QVector<QPointer<QWidget>>  mExcludedWidgets;
+    QVector<QPointer<QWidget>>  mHitMapWatched;
+    QSharedPointer<const FramelessHitMap> mHitMap;
+    bool                        mHitMapDirty = false;
+
+    // hit regions, scaled copies are cached until the dpi or the margins change
+    QMargins            mBorderMargins;
+    int                 mCornerExtent;
+    qreal               mBorderScale = 0;
+    QMargins            mScaledBorder;
+    int                 mScaledCornerExtent = 0;
+
+    // layout margin of the restored window, the maximized one has none
+    int                 mNormalLayoutMargin = 0;
+
+    // hovers deep inside the client area never reach the worker
+    QRect               mInnerSafeRect;
+    bool                mLastHoverInside = false;
+
+    // frame paced geometry commit
+    CommitMode          mCommitMode = CommitMode::Immediate;
+    QTimer *            mCommitTimer;
+    QElapsedTimer       mCommitClock;
+    QRect               mPendingGeometry;
+    bool                mPendingMove = false;
+    bool                mHasPendingGeometry = false;
+
+    // a drag restore sets its rect once the un-maximize has been seen, or
+    // when the drag ends at the latest
+    QRect               mPendingRestore;
+    bool                mHasPendingRestore = false;
+
+    // predictive software move
+    QElapsedTimer       mInputClock;
+    int                 mPredictionHorizon = 0;
+    int                 mPredictionClamp = 0;
+
+    // snapping and tiling, the index is rebuilt when a drag starts
+    int                 mSnapThreshold = 0;
+    bool                mWindowTiling = false;
+    QSharedPointer<const FramelessSnapIndex> mSnapIndex;
+    quint64             mGeometryCommitCount = 0;
+    FRAMELESS_STATS(qint64 mPendingInputNs = 0;)
 };
 
 #endif // FRAMELESS_H
@@ -0,0 +1,8 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    app \
+    tests \
+    benchmarks
+
+app.file = test.pro
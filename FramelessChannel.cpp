@@ -0,0 +1,153 @@
+#include "FramelessChannel.h"
+
+#include <QThread>
+
+FramelessCommand::FramelessCommand(Type type)
+    : type(type)
+{
+
+}
+
+bool FramelessCommand::supersedes(const FramelessCommand &other) const
+{
+    switch (type) {
+    case Move:
+    case SetGeometry:
+        return other.type == type;
+
+    case SetCursor:
+    case UnsetCursor:
+        return other.type == SetCursor || other.type == UnsetCursor;
+
+    default:
+        return false;
+    }
+}
+
+bool FramelessGeometry::isMaximized() const
+{
+    return windowState.testFlag(Qt::WindowMaximized);
+}
+
+bool FramelessGeometry::isFullScreen() const
+{
+    return windowState.testFlag(Qt::WindowFullScreen);
+}
+
+QPoint FramelessGeometry::mapFromGlobal(const QPoint &globalPoint) const
+{
+    return globalPoint + globalOffset;
+}
+
+const FramelessScreenInfo *FramelessGeometry::screenAt(const QPoint &globalPoint) const
+{
+    for (const FramelessScreenInfo &screen : screens) {
+        if (screen.geometry.contains(globalPoint))
+            return &screen;
+    }
+
+    return nullptr;
+}
+
+void FramelessDragPredictor::reset()
+{
+    *this = FramelessDragPredictor();
+}
+
+void FramelessDragPredictor::addSample(const QPoint &pos, qint64 timestamp)
+{
+    const qint64 elapsed = timestamp - lastTimestamp;
+    if (hasSample && elapsed > 0) {
+        // a pause in the drag starts over, otherwise smooth out jitter
+        const QPointF current = QPointF(pos - lastPos) * (1000.0 / elapsed);
+        velocity = elapsed > 100000 ? QPointF() : (velocity + current) / 2;
+    }
+
+    lastPos = pos;
+    lastTimestamp = timestamp;
+    hasSample = true;
+}
+
+QPoint FramelessDragPredictor::predict(int horizonMs, int clamp) const
+{
+    if (!hasSample || horizonMs <= 0)
+        return QPoint();
+
+    const QPointF ahead = velocity * horizonMs;
+    return QPoint(qBound(-clamp, qRound(ahead.x()), clamp),
+                  qBound(-clamp, qRound(ahead.y()), clamp));
+}
+
+FramelessChannel::FramelessChannel(Frameless *frameless)
+    : frameless(frameless)
+{
+
+}
+
+bool FramelessChannel::beginDispatch()
+{
+    if (state.fetchAndOrOrdered(Dispatching) & Closed) {
+        endDispatch();
+        return false;
+    }
+
+    return true;
+}
+
+void FramelessChannel::endDispatch()
+{
+    state.fetchAndAndOrdered(~Dispatching);
+}
+
+void FramelessChannel::close()
+{
+    state.fetchAndOrOrdered(Closed);
+    while (state.loadAcquire() & Dispatching)
+        QThread::yieldCurrentThread();
+}
+
+void FramelessChannel::ref()
+{
+    refCount.ref();
+}
+
+bool FramelessChannel::deref()
+{
+    return refCount.deref();
+}
+
+void FramelessChannel::releaseEvent(FramelessEvent *event)
+{
+    if (!event)
+        return;
+
+    switch (event->type()) {
+    case FramelessEvent::FocusIn:
+        std::get<FramelessEventPool<FramelessFocusInEvent>>(eventPools).release(static_cast<FramelessFocusInEvent *>(event));
+        break;
+
+    case FramelessEvent::MouseHover:
+        std::get<FramelessEventPool<FramelessMouseHoverEvent>>(eventPools).release(static_cast<FramelessMouseHoverEvent *>(event));
+        break;
+
+    case FramelessEvent::MousePress:
+        std::get<FramelessEventPool<FramelessMousePressEvent>>(eventPools).release(static_cast<FramelessMousePressEvent *>(event));
+        break;
+
+    case FramelessEvent::MouseMove:
+        std::get<FramelessEventPool<FramelessMouseMoveEvent>>(eventPools).release(static_cast<FramelessMouseMoveEvent *>(event));
+        break;
+
+    case FramelessEvent::MouseRelease:
+        std::get<FramelessEventPool<FramelessMouseReleaseEvent>>(eventPools).release(static_cast<FramelessMouseReleaseEvent *>(event));
+        break;
+
+    case FramelessEvent::Leave:
+        std::get<FramelessEventPool<FramelessLeaveEvent>>(eventPools).release(static_cast<FramelessLeaveEvent *>(event));
+        break;
+
+    default:
+        delete event;
+        break;
+    }
+}
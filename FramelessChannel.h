@@ -0,0 +1,147 @@
+#ifndef FRAMELESSCHANNEL_H
+#define FRAMELESSCHANNEL_H
+
+#include "FramelessHitMap.h"
+#include "FramelessRingBuffer.h"
+#include "FramelessScreenTopology.h"
+#include "FramelessSnapIndex.h"
+#include "FramelessTripleBuffer.h"
+#include "FramelessWorkerEvent.h"
+
+#include <QMargins>
+#include <QPoint>
+#include <QPointF>
+#include <QRect>
+#include <QSharedPointer>
+#include <QSize>
+#include <QVarLengthArray>
+
+#include <tuple>
+
+class Frameless;
+
+// Result of a worker computation, applied by Frameless on the GUI thread.
+struct FramelessCommand
+{
+    enum Type {
+        Invalid = -1,
+        Move,
+        SetGeometry,
+        SetCursor,
+        UnsetCursor,
+        StartMove,
+        StartResize,
+        FinishMoveResize,
+        Restore
+    };
+
+    explicit FramelessCommand(Type type = Invalid);
+
+    // a later command of the same kind makes this one redundant
+    bool supersedes(const FramelessCommand &other) const;
+
+    Type type = Invalid;
+    QPoint pos;
+    QRect rect;
+    int cursorShape = Qt::ArrowCursor;
+    FRAMELESS_STATS(qint64 inputNs = 0;)
+};
+
+// Immutable copy of the widget state the worker computes from, published by
+// Frameless on the GUI thread whenever the geometry or window state changes.
+struct FramelessGeometry
+{
+    bool isMaximized() const;
+    bool isFullScreen() const;
+    QPoint mapFromGlobal(const QPoint &globalPoint) const;
+    const FramelessScreenInfo *screenAt(const QPoint &globalPoint) const;
+
+    QRect originRect;
+    QPoint frameTopLeft;
+    QPoint clientOrigin;    // global position of the widget's own (0, 0)
+    QPoint globalOffset;
+    QSize minimumSize;
+    QSize maximumSize;
+    int layoutMargin = 0;
+    QMargins border;        // scaled grab widths per edge
+    int cornerExtent = 0;   // scaled reach of the corner zones along the edges
+    bool isWindow = true;
+    Qt::WindowStates windowState = Qt::WindowNoState;
+    QRect normalGeometry;
+    int normalLayoutMargin = 0;
+    int predictionHorizon = 0;
+    int predictionClamp = 0;
+    QVarLengthArray<FramelessScreenInfo, 4> screens;
+    int snapThreshold = 0;
+    bool windowTiling = false;
+    QSharedPointer<const FramelessSnapIndex> snapIndex;
+    QSharedPointer<const FramelessHitMap> hitMap;
+};
+
+// Pointer history of the software move in progress, owned by the worker
+// draining the channel. Extrapolates where the pointer will be when the
+// moved window reaches the screen.
+struct FramelessDragPredictor
+{
+    void reset();
+    void addSample(const QPoint &pos, qint64 timestamp);
+    QPoint predict(int horizonMs, int clamp) const;
+
+    QPoint lastPos;
+    qint64 lastTimestamp = 0;
+    QPointF velocity;       // pixels per millisecond
+    bool hasSample = false;
+};
+
+// Per-window mailbox between the GUI thread, which posts events, and the
+// worker thread, which drains them and answers with commands. The GUI thread
+// holds one reference and every pending schedule on a worker holds another.
+// Only one worker drains a channel at a time, so its rings and event pools
+// keep a single producer and a single consumer even when work is stolen.
+struct FramelessChannel
+{
+    enum State {
+        Closed      = 0x1,
+        Dispatching = 0x2
+    };
+
+    explicit FramelessChannel(Frameless *frameless);
+
+    bool beginDispatch();
+    void endDispatch();
+    void close();
+
+    void ref();
+    bool deref();
+
+    template<typename T>
+    T *acquireEvent()
+    {
+        return std::get<FramelessEventPool<T>>(eventPools).acquire();
+    }
+    void releaseEvent(FramelessEvent *event);
+
+    Frameless *                                 frameless = nullptr;
+    FramelessRingBuffer<FramelessEvent *, 256>  events;
+    FramelessRingBuffer<FramelessCommand, 256>  commands;
+    FramelessTripleBuffer<FramelessGeometry>    geometry;
+    QAtomicInt                                  scheduled;
+    QAtomicInt                                  drainScheduled;
+    QAtomicInt                                  state;
+    QAtomicInt                                  refCount = 1;
+
+    // commands of the batch the owning worker is dispatching, merged and
+    // published to the ring once per batch
+    QVarLengthArray<FramelessCommand, 16>       stagedCommands;
+    FramelessDragPredictor                      dragPredictor;
+    bool                                        restoredByDrag = false;
+
+    std::tuple<FramelessEventPool<FramelessFocusInEvent>,
+               FramelessEventPool<FramelessMouseHoverEvent>,
+               FramelessEventPool<FramelessMousePressEvent>,
+               FramelessEventPool<FramelessMouseMoveEvent>,
+               FramelessEventPool<FramelessMouseReleaseEvent>,
+               FramelessEventPool<FramelessLeaveEvent>> eventPools;
+};
+
+#endif // FRAMELESSCHANNEL_H
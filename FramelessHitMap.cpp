@@ -0,0 +1,40 @@
+#include "FramelessHitMap.h"
+
+FramelessHitMap::FramelessHitMap(bool hasCaptions)
+    : mHasCaptions(hasCaptions)
+{
+
+}
+
+void FramelessHitMap::addCaption(const QRect &rect)
+{
+    if (!rect.isEmpty())
+        mCaptions.append(rect);
+}
+
+void FramelessHitMap::addExcluded(const QRect &rect)
+{
+    if (!rect.isEmpty())
+        mExcluded.append(rect);
+}
+
+bool FramelessHitMap::isCaption(const QPoint &pos, bool canWindowMove) const
+{
+    bool caption = !mHasCaptions && canWindowMove;
+    for (const QRect &rect : mCaptions) {
+        if (rect.contains(pos)) {
+            caption = true;
+            break;
+        }
+    }
+
+    if (!caption)
+        return false;
+
+    for (const QRect &rect : mExcluded) {
+        if (rect.contains(pos))
+            return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef FRAMELESSHITMAP_H
+#define FRAMELESSHITMAP_H
+
+#include <QPoint>
+#include <QRect>
+#include <QVarLengthArray>
+
+// Caption and excluded rects of one window in its own coordinates. A point
+// drags the window when a caption rect holds it, or without registered
+// captions when the widget's own answer says so, and no excluded rect does.
+// Built on the GUI thread when the registered widgets change and then only
+// read by the worker.
+class FramelessHitMap
+{
+public:
+    explicit FramelessHitMap(bool hasCaptions);
+
+    void addCaption(const QRect &rect);
+    void addExcluded(const QRect &rect);
+
+    bool isCaption(const QPoint &pos, bool canWindowMove) const;
+
+private:
+    bool                        mHasCaptions;
+    QVarLengthArray<QRect, 4>   mCaptions;
+    QVarLengthArray<QRect, 8>   mExcluded;
+};
+
+#endif // FRAMELESSHITMAP_H
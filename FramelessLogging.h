@@ -0,0 +1,16 @@
+#ifndef FRAMELESSLOGGING_H
+#define FRAMELESSLOGGING_H
+
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(lcFrameless)
+
+// Hot-path tracing, compiled out unless DEFINES += FRAMELESS_ENABLE_LOGGING
+// and then still filtered by the "frameless" logging category.
+#ifdef FRAMELESS_ENABLE_LOGGING
+#define qCDebugFrameless() qCDebug(lcFrameless)
+#else
+#define qCDebugFrameless() QT_NO_QDEBUG_MACRO()
+#endif
+
+#endif // FRAMELESSLOGGING_H
@@ -0,0 +1,77 @@
+#ifndef FRAMELESSMPMCQUEUE_H
+#define FRAMELESSMPMCQUEUE_H
+
+#include <QAtomicInteger>
+
+// Bounded multi-producer/multi-consumer queue (Vyukov), every cell carries a
+// sequence number telling producers and consumers whose turn it is.
+// Capacity must be a power of two.
+template<typename T, int Capacity>
+class FramelessMpmcQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    FramelessMpmcQueue()
+    {
+        for (int i = 0; i < Capacity; ++i)
+            mCells[i].sequence.storeRelaxed(uint(i));
+    }
+
+    bool push(const T &value)
+    {
+        Cell *cell = nullptr;
+        uint pos = mEnqueuePos.loadRelaxed();
+        while (true) {
+            cell = &mCells[pos & (Capacity - 1)];
+            const int diff = int(cell->sequence.loadAcquire() - pos);
+            if (diff == 0) {
+                if (mEnqueuePos.testAndSetRelaxed(pos, pos + 1, pos))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = mEnqueuePos.loadRelaxed();
+            }
+        }
+
+        cell->data = value;
+        cell->sequence.storeRelease(pos + 1);
+        return true;
+    }
+
+    bool pop(T &value)
+    {
+        Cell *cell = nullptr;
+        uint pos = mDequeuePos.loadRelaxed();
+        while (true) {
+            cell = &mCells[pos & (Capacity - 1)];
+            const int diff = int(cell->sequence.loadAcquire() - (pos + 1));
+            if (diff == 0) {
+                if (mDequeuePos.testAndSetRelaxed(pos, pos + 1, pos))
+                    break;
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = mDequeuePos.loadRelaxed();
+            }
+        }
+
+        value = cell->data;
+        cell->sequence.storeRelease(pos + Capacity);
+        return true;
+    }
+
+private:
+    struct Cell
+    {
+        QAtomicInteger<uint> sequence;
+        T data;
+    };
+
+    Cell                                mCells[Capacity];
+    alignas(64) QAtomicInteger<uint>    mEnqueuePos;
+    alignas(64) QAtomicInteger<uint>    mDequeuePos;
+};
+
+#endif // FRAMELESSMPMCQUEUE_H
@@ -0,0 +1,61 @@
+#ifndef FRAMELESSRINGBUFFER_H
+#define FRAMELESSRINGBUFFER_H
+
+#include <QAtomicInteger>
+
+// Bounded single-producer/single-consumer ring, Capacity must be a power of two.
+template<typename T, int Capacity>
+class FramelessRingBuffer
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    bool push(const T &value)
+    {
+        const uint tail = mTail.loadRelaxed();
+        if (tail - mHead.loadAcquire() == uint(Capacity))
+            return false;
+
+        mSlots[tail & (Capacity - 1)] = value;
+        mTail.storeRelease(tail + 1);
+        return true;
+    }
+
+    bool pop(T &value)
+    {
+        const uint head = mHead.loadRelaxed();
+        if (head == mTail.loadAcquire())
+            return false;
+
+        value = mSlots[head & (Capacity - 1)];
+        mHead.storeRelease(head + 1);
+        return true;
+    }
+
+    bool peek(T &value) const
+    {
+        const uint head = mHead.loadRelaxed();
+        if (head == mTail.loadAcquire())
+            return false;
+
+        value = mSlots[head & (Capacity - 1)];
+        return true;
+    }
+
+    bool isEmpty() const
+    {
+        return mHead.loadAcquire() == mTail.loadAcquire();
+    }
+
+    int size() const
+    {
+        return int(mTail.loadAcquire() - mHead.loadAcquire());
+    }
+
+private:
+    alignas(64) QAtomicInteger<uint> mHead;
+    alignas(64) QAtomicInteger<uint> mTail;
+    alignas(64) T mSlots[Capacity];
+};
+
+#endif // FRAMELESSRINGBUFFER_H
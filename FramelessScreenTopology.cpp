@@ -0,0 +1,72 @@
+#include "FramelessScreenTopology.h"
+
+#include <QGuiApplication>
+#include <QScreen>
+
+FramelessScreenTopology *FramelessScreenTopology::instance()
+{
+    static FramelessScreenTopology *topology = new FramelessScreenTopology(qApp);
+    return topology;
+}
+
+FramelessScreenTopology::FramelessScreenTopology(QObject *parent)
+    : QObject(parent)
+{
+    connect(qApp, &QGuiApplication::screenAdded, this, [this](QScreen *screen) {
+        watchScreen(screen);
+        invalidate();
+    });
+    connect(qApp, &QGuiApplication::screenRemoved, this, &FramelessScreenTopology::invalidate);
+
+    for (QScreen *screen : QGuiApplication::screens())
+        watchScreen(screen);
+}
+
+const QVector<FramelessScreenInfo> &FramelessScreenTopology::screens()
+{
+    if (mDirty)
+        rebuild();
+
+    return mScreens;
+}
+
+const FramelessScreenInfo *FramelessScreenTopology::screenInfo(const QScreen *screen)
+{
+    if (mDirty)
+        rebuild();
+
+    const int index = mScreenHandles.indexOf(const_cast<QScreen *>(screen));
+    return index < 0 ? nullptr : &mScreens.at(index);
+}
+
+void FramelessScreenTopology::watchScreen(QScreen *screen)
+{
+    connect(screen, &QScreen::geometryChanged, this, &FramelessScreenTopology::invalidate, Qt::UniqueConnection);
+    connect(screen, &QScreen::availableGeometryChanged, this, &FramelessScreenTopology::invalidate, Qt::UniqueConnection);
+    connect(screen, &QScreen::physicalDotsPerInchChanged, this, &FramelessScreenTopology::invalidate, Qt::UniqueConnection);
+    connect(screen, &QScreen::logicalDotsPerInchChanged, this, &FramelessScreenTopology::invalidate, Qt::UniqueConnection);
+    connect(screen, &QScreen::refreshRateChanged, this, &FramelessScreenTopology::invalidate, Qt::UniqueConnection);
+}
+
+void FramelessScreenTopology::invalidate()
+{
+    mDirty = true;
+    Q_EMIT changed();
+}
+
+void FramelessScreenTopology::rebuild()
+{
+    mDirty = false;
+    mScreenHandles = QGuiApplication::screens().toVector();
+    mScreens.resize(mScreenHandles.size());
+
+    for (int i = 0; i < mScreenHandles.size(); ++i) {
+        const QScreen *screen = mScreenHandles.at(i);
+        FramelessScreenInfo &info = mScreens[i];
+        info.geometry = screen->geometry();
+        info.availableGeometry = screen->availableGeometry();
+        info.devicePixelRatio = screen->devicePixelRatio();
+        info.logicalDpi = screen->logicalDotsPerInch();
+        info.refreshRate = qMax<qreal>(screen->refreshRate(), 1);
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef FRAMELESSSCREENTOPOLOGY_H
+#define FRAMELESSSCREENTOPOLOGY_H
+
+#include <QObject>
+#include <QRect>
+#include <QVector>
+
+class QScreen;
+struct FramelessScreenInfo
+{
+    QRect geometry;
+    QRect availableGeometry;
+    qreal devicePixelRatio = 1;
+    qreal logicalDpi = 96;
+    qreal refreshRate = 60;
+};
+
+// Flat, cached copy of every screen, rebuilt lazily after Qt reports a
+// screen being added, removed or changing shape. Lives on the GUI thread;
+// workers get the array through the published FramelessGeometry.
+class FramelessScreenTopology : public QObject
+{
+    Q_OBJECT
+public:
+    static FramelessScreenTopology *instance();
+
+    const QVector<FramelessScreenInfo> &screens();
+    const FramelessScreenInfo *screenInfo(const QScreen *screen);
+
+Q_SIGNALS:
+    void changed();
+
+private:
+    explicit FramelessScreenTopology(QObject *parent = nullptr);
+
+    void watchScreen(QScreen *screen);
+    void invalidate();
+    void rebuild();
+
+private:
+    QVector<QScreen *>              mScreenHandles;
+    QVector<FramelessScreenInfo>    mScreens;
+    bool                            mDirty = true;
+};
+
+#endif // FRAMELESSSCREENTOPOLOGY_H
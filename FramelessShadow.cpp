@@ -0,0 +1,123 @@
+#include "FramelessShadow.h"
+
+#include <QImage>
+#include <QPainter>
+#include <QPixmapCache>
+#include <QRegion>
+#include <QVector>
+
+QPixmap FramelessShadow::ninePatch(int radius, const QColor &color, qreal devicePixelRatio)
+{
+    const QString key = QStringLiteral("frameless-shadow-%1-%2-%3")
+            .arg(radius).arg(color.rgba()).arg(devicePixelRatio);
+
+    QPixmap pixmap;
+    if (QPixmapCache::find(key, &pixmap))
+        return pixmap;
+
+    // the shadow fades over 2 * radius across the content edge, so each
+    // corner is 2 * radius wide and the edges are a single stretched pixel
+    const int r = qMax(1, qRound(radius * devicePixelRatio));
+    const int corner = 2 * r;
+    const int side = 2 * corner + 1;
+
+    QImage mask(side, side, QImage::Format_Alpha8);
+    mask.fill(0);
+    {
+        QPainter painter(&mask);
+        painter.fillRect(QRect(r, r, side - 2 * r, side - 2 * r), QColor(0, 0, 0, 255));
+    }
+    blurAlpha(mask, r);
+
+    QImage image(side, side, QImage::Format_ARGB32_Premultiplied);
+    image.fill(color);
+    {
+        QPainter painter(&image);
+        painter.setCompositionMode(QPainter::CompositionMode_DestinationIn);
+        painter.drawImage(0, 0, mask);
+    }
+
+    pixmap = QPixmap::fromImage(image);
+    pixmap.setDevicePixelRatio(devicePixelRatio);
+    QPixmapCache::insert(key, pixmap);
+    return pixmap;
+}
+
+void FramelessShadow::paint(QPainter *painter, const QRect &contentRect, int radius, const QColor &color)
+{
+    if (radius <= 0)
+        return;
+
+    const qreal dpr = painter->device()->devicePixelRatioF();
+    const QPixmap pixmap = ninePatch(radius, color, dpr);
+
+    const QRect target = contentRect.adjusted(-radius, -radius, radius, radius);
+    const int margin = 2 * radius;
+    const int width = target.width() - 2 * margin;
+    const int height = target.height() - 2 * margin;
+    if (width < 0 || height < 0)
+        return;
+
+    const int corner = (pixmap.width() - 1) / 2;
+    const int left = target.left();
+    const int top = target.top();
+    const int right = target.right() + 1 - margin;
+    const int bottom = target.bottom() + 1 - margin;
+
+    // the patches reach radius pixels into the content, keep them out of it,
+    // a translucent window would show them through non-opaque content
+    painter->save();
+    painter->setClipRegion(QRegion(target) - QRegion(contentRect), Qt::IntersectClip);
+
+    // corners
+    painter->drawPixmap(QRectF(left, top, margin, margin), pixmap, QRectF(0, 0, corner, corner));
+    painter->drawPixmap(QRectF(right, top, margin, margin), pixmap, QRectF(corner + 1, 0, corner, corner));
+    painter->drawPixmap(QRectF(left, bottom, margin, margin), pixmap, QRectF(0, corner + 1, corner, corner));
+    painter->drawPixmap(QRectF(right, bottom, margin, margin), pixmap, QRectF(corner + 1, corner + 1, corner, corner));
+
+    // edges, the center is never painted
+    painter->drawPixmap(QRectF(left + margin, top, width, margin), pixmap, QRectF(corner, 0, 1, corner));
+    painter->drawPixmap(QRectF(left + margin, bottom, width, margin), pixmap, QRectF(corner, corner + 1, 1, corner));
+    painter->drawPixmap(QRectF(left, top + margin, margin, height), pixmap, QRectF(0, corner, corner, 1));
+    painter->drawPixmap(QRectF(right, top + margin, margin, height), pixmap, QRectF(corner + 1, corner, corner, 1));
+
+    painter->restore();
+}
+
+void FramelessShadow::blurAlpha(QImage &mask, int radius)
+{
+    // three box passes per direction approximate a gaussian of the same extent
+    const int box = qMax(1, radius / 3);
+    const int window = 2 * box + 1;
+    const int width = mask.width();
+    const int height = mask.height();
+    const int stride = mask.bytesPerLine();
+
+    QVector<uchar> line(qMax(width, height));
+    auto blurLine = [&](uchar *data, int length, int step) {
+        for (int i = 0; i < length; ++i)
+            line[i] = data[i * step];
+
+        int sum = 0;
+        for (int i = 0; i <= box && i < length; ++i)
+            sum += line[i];
+
+        for (int i = 0; i < length; ++i) {
+            data[i * step] = uchar(sum / window);
+
+            if (i + box + 1 < length)
+                sum += line[i + box + 1];
+            if (i - box >= 0)
+                sum -= line[i - box];
+        }
+    };
+
+    uchar *bits = mask.bits();
+    for (int pass = 0; pass < 3; ++pass) {
+        for (int y = 0; y < height; ++y)
+            blurLine(bits + y * stride, width, 1);
+
+        for (int x = 0; x < width; ++x)
+            blurLine(bits + x, height, stride);
+    }
+}
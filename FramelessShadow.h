@@ -0,0 +1,21 @@
+#ifndef FRAMELESSSHADOW_H
+#define FRAMELESSSHADOW_H
+
+#include <QColor>
+#include <QPixmap>
+
+class QPainter;
+class FramelessShadow
+{
+public:
+    // blurred once per (radius, color, device pixel ratio) and then cached
+    static QPixmap ninePatch(int radius, const QColor &color, qreal devicePixelRatio);
+
+    // paints the shadow ring around contentRect, the content itself is left out
+    static void paint(QPainter *painter, const QRect &contentRect, int radius, const QColor &color);
+
+private:
+    static void blurAlpha(QImage &mask, int radius);
+};
+
+#endif // FRAMELESSSHADOW_H
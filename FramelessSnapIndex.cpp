@@ -0,0 +1,55 @@
+#include "FramelessSnapIndex.h"
+
+#include <algorithm>
+
+void FramelessSnapIndex::addRect(const QRect &rect)
+{
+    if (rect.isEmpty())
+        return;
+
+    // boundaries rather than pixels, so one window's right meets another's left
+    const int left = rect.left();
+    const int right = rect.left() + rect.width();
+    const int top = rect.top();
+    const int bottom = rect.top() + rect.height();
+
+    mVertical.append({ left, top, bottom });
+    mVertical.append({ right, top, bottom });
+    mHorizontal.append({ top, left, right });
+    mHorizontal.append({ bottom, left, right });
+}
+
+void FramelessSnapIndex::finalize()
+{
+    std::sort(mVertical.begin(), mVertical.end());
+    std::sort(mHorizontal.begin(), mHorizontal.end());
+}
+
+bool FramelessSnapIndex::snapVertical(int x, int from, int to, int threshold, int *delta) const
+{
+    return snap(mVertical, x, from, to, threshold, delta);
+}
+
+bool FramelessSnapIndex::snapHorizontal(int y, int from, int to, int threshold, int *delta) const
+{
+    return snap(mHorizontal, y, from, to, threshold, delta);
+}
+
+bool FramelessSnapIndex::snap(const QVector<Line> &lines, int value, int from, int to, int threshold, int *delta)
+{
+    const Line lower = { value - threshold, 0, 0 };
+    bool found = false;
+    for (auto it = std::lower_bound(lines.cbegin(), lines.cend(), lower);
+         it != lines.cend() && it->pos <= value + threshold; ++it) {
+        if (it->to < from || it->from > to)
+            continue;
+
+        const int offset = it->pos - value;
+        if (!found || qAbs(offset) < qAbs(*delta)) {
+            *delta = offset;
+            found = true;
+        }
+    }
+
+    return found;
+}
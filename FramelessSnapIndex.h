@@ -0,0 +1,42 @@
+#ifndef FRAMELESSSNAPINDEX_H
+#define FRAMELESSSNAPINDEX_H
+
+#include <QRect>
+#include <QVector>
+
+// Edge lines of the screens' work areas and the other frameless windows,
+// sorted by position so a snap lookup is a binary search plus the few lines
+// inside the threshold. Built on the GUI thread when a drag starts and then
+// only read by the worker.
+class FramelessSnapIndex
+{
+public:
+    void addRect(const QRect &rect);
+    void finalize();
+
+    // offset that moves value onto the nearest line within threshold whose
+    // span overlaps [from, to], false when there is none
+    bool snapVertical(int x, int from, int to, int threshold, int *delta) const;
+    bool snapHorizontal(int y, int from, int to, int threshold, int *delta) const;
+
+private:
+    struct Line
+    {
+        int pos;
+        int from;
+        int to;
+
+        bool operator<(const Line &other) const
+        {
+            return pos < other.pos;
+        }
+    };
+
+    static bool snap(const QVector<Line> &lines, int value, int from, int to, int threshold, int *delta);
+
+private:
+    QVector<Line>   mVertical;
+    QVector<Line>   mHorizontal;
+};
+
+#endif // FRAMELESSSNAPINDEX_H
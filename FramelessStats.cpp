@@ -0,0 +1,175 @@
+#include "FramelessStats.h"
+
+// the counters and the trace ring only exist in instrumented builds
+#ifdef FRAMELESS_ENABLE_STATS
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+
+namespace {
+
+struct StageCounters
+{
+    QAtomicInteger<quint64> count;
+    QAtomicInteger<quint64> totalNs;
+    QAtomicInteger<quint64> maxNs;
+};
+
+struct TraceRecord
+{
+    int stage;
+    qint64 startNs;
+    qint64 durationNs;
+    quintptr thread;
+};
+
+enum {
+    TraceCapacity = 1 << 16
+};
+
+QAtomicInteger<quint64> posted;
+QAtomicInteger<quint64> coalesced;
+QAtomicInteger<quint64> dropped;
+QAtomicInteger<quint64> queueHighWater;
+StageCounters stages[FramelessStats::StageCount];
+
+QAtomicInt traceEnabled;
+QAtomicInteger<uint> traceNext;
+TraceRecord traceRecords[TraceCapacity];
+
+const char *const StageNames[FramelessStats::StageCount] = {
+    "queue",
+    "compute",
+    "apply"
+};
+
+const QElapsedTimer &clock()
+{
+    static const QElapsedTimer timer = [] {
+        QElapsedTimer t;
+        t.start();
+        return t;
+    }();
+
+    return timer;
+}
+
+}
+
+qint64 FramelessStats::now()
+{
+    return clock().nsecsElapsed();
+}
+
+void FramelessStats::recordStage(Stage stage, qint64 startNs, qint64 endNs)
+{
+    if (startNs <= 0 || endNs < startNs)
+        return;
+
+    const quint64 duration = quint64(endNs - startNs);
+    StageCounters &counters = stages[stage];
+    counters.count.fetchAndAddRelaxed(1);
+    counters.totalNs.fetchAndAddRelaxed(duration);
+    updateMax(counters.maxNs, duration);
+
+    if (!traceEnabled.loadRelaxed())
+        return;
+
+    // a fixed ring, old spans are overwritten instead of growing without bound
+    TraceRecord &record = traceRecords[traceNext.fetchAndAddRelaxed(1) & (TraceCapacity - 1)];
+    record.stage = stage;
+    record.startNs = startNs;
+    record.durationNs = qint64(duration);
+    record.thread = quintptr(QThread::currentThreadId());
+}
+
+void FramelessStats::recordPosted(int queueDepth)
+{
+    posted.fetchAndAddRelaxed(1);
+    updateMax(queueHighWater, quint64(queueDepth));
+}
+
+void FramelessStats::recordCoalesced()
+{
+    coalesced.fetchAndAddRelaxed(1);
+}
+
+void FramelessStats::recordDropped()
+{
+    dropped.fetchAndAddRelaxed(1);
+}
+
+FramelessStats::Snapshot FramelessStats::snapshot()
+{
+    Snapshot snapshot;
+    snapshot.posted = posted.loadRelaxed();
+    snapshot.coalesced = coalesced.loadRelaxed();
+    snapshot.dropped = dropped.loadRelaxed();
+    snapshot.queueHighWater = queueHighWater.loadRelaxed();
+
+    for (int i = 0; i < StageCount; ++i) {
+        snapshot.stages[i].count = stages[i].count.loadRelaxed();
+        snapshot.stages[i].totalNs = stages[i].totalNs.loadRelaxed();
+        snapshot.stages[i].maxNs = stages[i].maxNs.loadRelaxed();
+    }
+
+    return snapshot;
+}
+
+void FramelessStats::reset()
+{
+    posted.storeRelaxed(0);
+    coalesced.storeRelaxed(0);
+    dropped.storeRelaxed(0);
+    queueHighWater.storeRelaxed(0);
+
+    for (StageCounters &counters : stages) {
+        counters.count.storeRelaxed(0);
+        counters.totalNs.storeRelaxed(0);
+        counters.maxNs.storeRelaxed(0);
+    }
+
+    traceNext.storeRelaxed(0);
+}
+
+void FramelessStats::setTraceEnabled(bool enabled)
+{
+    traceEnabled.storeRelaxed(enabled);
+}
+
+bool FramelessStats::writeChromeTrace(const QString &fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    // spans still being written by a worker may come out torn, dump after the run
+    const uint next = traceNext.loadRelaxed();
+    const uint count = qMin<uint>(next, TraceCapacity);
+    const uint first = next - count;
+
+    file.write("{\"traceEvents\":[\n");
+    for (uint i = 0; i < count; ++i) {
+        const TraceRecord &record = traceRecords[(first + i) & (TraceCapacity - 1)];
+        const QString line = QStringLiteral("%1{\"name\":\"%2\",\"ph\":\"X\",\"pid\":1,\"tid\":%3,\"ts\":%4,\"dur\":%5}\n")
+                .arg(i ? QStringLiteral(",") : QString())
+                .arg(QLatin1String(StageNames[record.stage]))
+                .arg(record.thread)
+                .arg(record.startNs / 1000.0, 0, 'f', 3)
+                .arg(record.durationNs / 1000.0, 0, 'f', 3);
+        file.write(line.toUtf8());
+    }
+    file.write("],\"displayTimeUnit\":\"ns\"}\n");
+
+    return true;
+}
+
+void FramelessStats::updateMax(QAtomicInteger<quint64> &value, quint64 candidate)
+{
+    quint64 current = value.loadRelaxed();
+    while (candidate > current && !value.testAndSetRelaxed(current, candidate, current)) {
+    }
+}
+
+#endif // FRAMELESS_ENABLE_STATS
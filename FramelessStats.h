@@ -0,0 +1,59 @@
+#ifndef FRAMELESSSTATS_H
+#define FRAMELESSSTATS_H
+
+#include <QAtomicInteger>
+#include <QString>
+
+// Input-to-geometry instrumentation. Everything below compiles to nothing
+// unless the project is built with DEFINES += FRAMELESS_ENABLE_STATS.
+#ifdef FRAMELESS_ENABLE_STATS
+#define FRAMELESS_STATS(...) __VA_ARGS__
+#else
+#define FRAMELESS_STATS(...)
+#endif
+
+class FramelessStats
+{
+public:
+    enum Stage {
+        QueueWait,      // input entered targetEvent -> worker dequeued it
+        Compute,        // worker dispatch of one event
+        Apply,          // input entered targetEvent -> geometry set on the GUI thread
+        StageCount
+    };
+
+    struct StageStats
+    {
+        quint64 count = 0;
+        quint64 totalNs = 0;
+        quint64 maxNs = 0;
+    };
+
+    struct Snapshot
+    {
+        quint64 posted = 0;
+        quint64 coalesced = 0;
+        quint64 dropped = 0;
+        quint64 queueHighWater = 0;
+        quint64 heapAllocations = 0;
+        StageStats stages[StageCount];
+    };
+
+    static qint64 now();
+    static void recordStage(Stage stage, qint64 startNs, qint64 endNs);
+    static void recordPosted(int queueDepth);
+    static void recordCoalesced();
+    static void recordDropped();
+
+    static Snapshot snapshot();
+    static void reset();
+
+    // chrome://tracing compatible dump of the most recent stage spans
+    static void setTraceEnabled(bool enabled);
+    static bool writeChromeTrace(const QString &fileName);
+
+private:
+    static void updateMax(QAtomicInteger<quint64> &value, quint64 candidate);
+};
+
+#endif // FRAMELESSSTATS_H
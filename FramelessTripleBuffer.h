@@ -0,0 +1,39 @@
+#ifndef FRAMELESSTRIPLEBUFFER_H
+#define FRAMELESSTRIPLEBUFFER_H
+
+#include <QAtomicInteger>
+
+// Wait-free single-writer/single-reader snapshot. The writer always fills a
+// private back buffer and swaps it with the shared middle one, the reader
+// picks the middle buffer up only when it is fresher than its own.
+template<typename T>
+class FramelessTripleBuffer
+{
+public:
+    void publish(const T &value)
+    {
+        mBuffers[mBack] = value;
+        mBack = mMiddle.fetchAndStoreAcquireRelease(mBack | Fresh) & IndexMask;
+    }
+
+    const T &read()
+    {
+        if (mMiddle.loadRelaxed() & Fresh)
+            mFront = mMiddle.fetchAndStoreAcquireRelease(mFront) & IndexMask;
+
+        return mBuffers[mFront];
+    }
+
+private:
+    enum {
+        IndexMask   = 0x3,
+        Fresh       = 0x4
+    };
+
+    T                       mBuffers[3];
+    int                     mBack = 0;
+    int                     mFront = 2;
+    alignas(64) QAtomicInt  mMiddle = 1;
+};
+
+#endif // FRAMELESSTRIPLEBUFFER_H
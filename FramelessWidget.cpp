@@ -1,6 +1,8 @@
 #include "FramelessWidget.h"
 #include "AppGlobalInfo.h"
 #include "Frameless.h"
+#include "FramelessScreenTopology.h"
+#include "FramelessShadow.h"
 #include "MachineHelper.h"
 #include "gadgets/WarnMessageLabel.h"
 
@@ -9,14 +11,22 @@
 #include <QDebug>
 #include <QGraphicsEffect>
 #include <QBoxLayout>
+#include <QPainter>
 
-FramelessWidget::FramelessWidget(QWidget *parent)
+#define FRAMELESS_SHADOW_RADIUS 10
+
+FramelessWidget::FramelessWidget(QWidget *parent, Frameless::ExecutionPolicy policy)
     : QWidget(parent, Qt::Window)
     , m_window(nullptr)
     , m_screen(nullptr)
-    , mFrameless(new Frameless(this, this))
+    , mFrameless(new Frameless(this, this, policy))
     , mPromptLabel(new WarnMessageLabel(this))
+    , mShadowWidget(nullptr)
+    , mShadowSuspended(false)
+    , mCanWindowMoveValid(false)
 {
+    connect(mFrameless, &Frameless::interactiveMoveResizeStarted, this, &FramelessWidget::onInteractiveMoveResizeStarted);
+    connect(mFrameless, &Frameless::interactiveMoveResizeFinished, this, &FramelessWidget::onInteractiveMoveResizeFinished);
 }
 
 int FramelessWidget::framelessBorder() const
@@ -57,12 +67,9 @@ void FramelessWidget::changeEvent(QEvent *e)
         if (windowState().testFlag(Qt::WindowMaximized)
                 || windowState().testFlag(Qt::WindowFullScreen)) {
             layout->setMargin(0);
-
-            if (auto effect = graphicsWidget->graphicsEffect()) {
-                effect->deleteLater();
-            }
+            mShadowWidget = nullptr;
         } else if (windowState().testFlag(Qt::WindowNoState)) {
-            initGraphicsEffect(graphicsWidget);
+            initDropShadow(graphicsWidget);
         }
     }
 
@@ -80,15 +87,18 @@ bool FramelessWidget::event(QEvent *e)
         QWidget *graphicsWidget = layout->itemAt(0)->widget();
         Q_ASSERT(graphicsWidget);
 
-        if (graphicsWidget->graphicsEffect())
+        if (mShadowWidget == graphicsWidget)
             return QWidget::event(e);
 
-        layout->setMargin(10);
-        initGraphicsEffect(graphicsWidget);
+        layout->setMargin(FRAMELESS_SHADOW_RADIUS);
+        initDropShadow(graphicsWidget);
     } else {
-        if (e->type() == QEvent::MouseButtonPress
-                || e->type() == QEvent::MouseMove) {
+        // asked once and cached until invalidateCanWindowMove(), a registered
+        // caption map is evaluated by the worker instead
+        if (!mCanWindowMoveValid && !mFrameless->hasCaptions()
+                && (e->type() == QEvent::MouseButtonPress || e->type() == QEvent::MouseButtonDblClick)) {
             mFrameless->setCanWindowMove(canWindowMove());
+            mCanWindowMoveValid = true;
         }
 
         mFrameless->targetEvent(e);
@@ -102,6 +112,21 @@ bool FramelessWidget::withDropShadow()
     return MachineHelper::canUseCompositing();
 }
 
+void FramelessWidget::beginInteractiveMoveResize(bool resizing)
+{
+    Q_UNUSED(resizing);
+}
+
+void FramelessWidget::endInteractiveMoveResize()
+{
+
+}
+
+bool FramelessWidget::isInteractiveMoveResize() const
+{
+    return mFrameless->isInteractiveMoveResize();
+}
+
 void FramelessWidget::setCanWindowResize(bool canResize)
 {
     mFrameless->setCanWindowResize(canResize);
@@ -112,6 +137,26 @@ bool FramelessWidget::canWindowResize() const
     return mFrameless->canWindowResize();
 }
 
+void FramelessWidget::invalidateCanWindowMove()
+{
+    mCanWindowMoveValid = false;
+}
+
+void FramelessWidget::addCaptionRect(const QRect &rect)
+{
+    mFrameless->addCaptionRect(rect);
+}
+
+void FramelessWidget::addCaptionWidget(QWidget *widget)
+{
+    mFrameless->addCaptionWidget(widget);
+}
+
+void FramelessWidget::addExcludedWidget(QWidget *widget)
+{
+    mFrameless->addExcludedWidget(widget);
+}
+
 void FramelessWidget::onWindowScreenChanged()
 {
     Q_ASSERT(m_window);
@@ -129,30 +174,64 @@ void FramelessWidget::onWindowScreenChanged()
 
 void FramelessWidget::onScreenSizeChanged()
 {
-    if (this->isWindow() && this->isMaximized()) {
-        if (m_screen->availableGeometry() != this->geometry()) {
-            this->setGeometry(m_screen->availableGeometry());
+    const FramelessScreenInfo *screen = FramelessScreenTopology::instance()->screenInfo(m_screen);
+    if (screen && this->isWindow() && this->isMaximized()) {
+        if (screen->availableGeometry != this->geometry()) {
+            this->setGeometry(screen->availableGeometry);
             this->setWindowState(this->windowState() | Qt::WindowMaximized);
         }
     }
 }
 
-void FramelessWidget::initGraphicsEffect(QWidget *graphicsWidget)
+void FramelessWidget::onInteractiveMoveResizeStarted(bool resizing)
+{
+    // only a software resize repaints the window for every intermediate rect,
+    // leave the shadow ring out until it is over; moves and native resizes
+    // keep the window contents and lose nothing by keeping the shadow
+    if (mShadowWidget && resizing && !mFrameless->acceptSystemResize()) {
+        mShadowSuspended = true;
+        update();
+    }
+
+    beginInteractiveMoveResize(resizing);
+}
+
+void FramelessWidget::onInteractiveMoveResizeFinished()
+{
+    if (mShadowSuspended) {
+        mShadowSuspended = false;
+        update();
+    }
+
+    endInteractiveMoveResize();
+}
+
+void FramelessWidget::paintEvent(QPaintEvent *event)
+{
+    if (!mShadowWidget || mShadowSuspended)
+        return QWidget::paintEvent(event);
+
+    QPainter painter(this);
+    FramelessShadow::paint(&painter, mShadowWidget->geometry(), FRAMELESS_SHADOW_RADIUS, QColor(63, 63, 63, 180));
+}
+
+void FramelessWidget::initDropShadow(QWidget *graphicsWidget)
 {
     Q_ASSERT(graphicsWidget);
 
+    if (graphicsWidget->graphicsEffect())
+        graphicsWidget->graphicsEffect()->deleteLater();
+
     if (Q_LIKELY(MachineHelper::canUseCompositing())) {
-        qobject_cast<QBoxLayout *>(this->layout())->setMargin(10);
+        qobject_cast<QBoxLayout *>(this->layout())->setMargin(FRAMELESS_SHADOW_RADIUS);
 
-        QGraphicsDropShadowEffect *effect = new QGraphicsDropShadowEffect(this);
-        effect->setBlurRadius(20);
-        effect->setOffset(0);
-        graphicsWidget->setGraphicsEffect(effect);
+        // painted from a cached nine-patch in paintEvent instead of blurring
+        // the whole content through a graphics effect on every repaint
+        mShadowWidget = graphicsWidget;
+        update();
         return;
     }
 
     this->layout()->setMargin(5);
-
-    if (graphicsWidget->graphicsEffect())
-        graphicsWidget->graphicsEffect()->deleteLater();
+    mShadowWidget = nullptr;
 }
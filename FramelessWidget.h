@@ -1,15 +1,17 @@
 #ifndef FRAMELESSWIDGET_H
 #define FRAMELESSWIDGET_H
 
+#include "Frameless.h"
+
 #include <QWidget>
 
-class Frameless;
 class WarnMessageLabel;
 class FramelessWidget : public QWidget
 {
     Q_OBJECT
 public:
-    explicit FramelessWidget(QWidget *parent = nullptr);
+    explicit FramelessWidget(QWidget *parent = nullptr,
+                             Frameless::ExecutionPolicy policy = Frameless::ExecutionPolicy::SharedWorker);
     int framelessBorder() const;
 
     void showPromptMsg(const QString &msg);
@@ -17,25 +19,45 @@ public:
 protected:
     void showEvent(QShowEvent *event) override;
     void changeEvent(QEvent *) override;
+    void paintEvent(QPaintEvent *event) override;
     bool event(QEvent *e) override;
     virtual bool withDropShadow();
     virtual bool canWindowMove() = 0;
 
+    // canWindowMove() is cached, call this when its answer may have changed
+    void invalidateCanWindowMove();
+
+    // called around an interactive move/resize, pause heavy rendering here
+    virtual void beginInteractiveMoveResize(bool resizing);
+    virtual void endInteractiveMoveResize();
+    bool isInteractiveMoveResize() const;
+
     void setCanWindowResize(bool canResize);
     bool canWindowResize() const;
 
+    // once a caption is registered canWindowMove() is no longer called,
+    // excluded widgets alone only carve holes into its answer
+    void addCaptionRect(const QRect &rect);
+    void addCaptionWidget(QWidget *widget);
+    void addExcludedWidget(QWidget *widget);
+
 protected Q_SLOTS:
     void onWindowScreenChanged();
     void onScreenSizeChanged();
+    void onInteractiveMoveResizeStarted(bool resizing);
+    void onInteractiveMoveResizeFinished();
 
 private:
-    void initGraphicsEffect(QWidget *graphicsWidget);
+    void initDropShadow(QWidget *graphicsWidget);
 
 private:
     QWindow             *m_window;
     QScreen             *m_screen;
     Frameless           *mFrameless;
     WarnMessageLabel    *mPromptLabel;
+    QWidget             *mShadowWidget;
+    bool                mShadowSuspended;
+    bool                mCanWindowMoveValid;
 };
 
 #endif // FRAMELESSWIDGET_H
@@ -1,159 +1,530 @@
 #include "FramelessWorker.h"
 #include "Frameless.h"
 #include "FramelessWorkerEvent.h"
+#include "FramelessLogging.h"
 
 #include <QWidget>
 #include <QApplication>
-#include <QDebug>
-#include <QLayout>
 
-FramelessWorker *FramelessWorker::mInstance = nullptr;
+namespace {
+
+// pointer travel that turns a press on a maximized caption into a drag
+constexpr int DragRestoreDistance = 4;
+
+// events one window handles before the other windows on its worker get a turn
+constexpr int EventsPerTurn = 64;
+
+enum HitZone {
+    NearBand        = 0x1,  // left or top band, [edge, edge + border)
+    FarBand         = 0x2,  // right or bottom band, (edge - border, edge]
+    CornerBand      = 0x4,  // top-right corner bands, right and top with closed bounds
+    HitZoneCount    = 0x8
+};
+
+struct HitEntry
+{
+    Frameless::Direction dir;
+    Qt::CursorShape cursorShape;
+};
+
+// Resolves one horizontal and one vertical zone in the priority order the
+// border hit test has always used: corners first, then edges.
+constexpr HitEntry classifyHitZone(int h, int v)
+{
+    if ((h & NearBand) && (v & NearBand))
+        return { Frameless::Direction::TopLeft, Qt::SizeFDiagCursor };
+    if ((h & FarBand) && (v & FarBand))
+        return { Frameless::Direction::BottomRight, Qt::SizeFDiagCursor };
+    if ((h & NearBand) && (v & FarBand))
+        return { Frameless::Direction::BottomLeft, Qt::SizeBDiagCursor };
+    if ((h & CornerBand) && (v & CornerBand))
+        return { Frameless::Direction::TopRight, Qt::SizeBDiagCursor };
+    if (h & NearBand)
+        return { Frameless::Direction::Left, Qt::SizeHorCursor };
+    if (h & FarBand)
+        return { Frameless::Direction::Right, Qt::SizeHorCursor };
+    if (v & NearBand)
+        return { Frameless::Direction::Up, Qt::SizeVerCursor };
+    if (v & FarBand)
+        return { Frameless::Direction::Down, Qt::SizeVerCursor };
+
+    return { Frameless::Direction::None, Qt::ArrowCursor };
+}
+
+struct HitTableType
+{
+    constexpr HitTableType()
+        : entries()
+    {
+        for (int h = 0; h < HitZoneCount; ++h) {
+            for (int v = 0; v < HitZoneCount; ++v)
+                entries[h][v] = classifyHitZone(h, v);
+        }
+    }
+
+    constexpr const HitEntry *operator[](int h) const
+    {
+        return entries[h];
+    }
+
+    HitEntry entries[HitZoneCount][HitZoneCount];
+};
+
+constexpr HitTableType HitTable;
+
+}
+
+QVector<FramelessWorker *> FramelessWorker::mPool;
+int FramelessWorker::mPoolSize = 0;
 
 FramelessWorker::FramelessWorker(QObject *parent)
     : QThread{parent}
-    , mExit(false)
+    , mExit(0)
+    , mParked(0)
 {
     connect(qApp, &QApplication::aboutToQuit, this, &FramelessWorker::exit);
 }
 
-FramelessWorker *FramelessWorker::instance()
+FramelessWorker::~FramelessWorker()
 {
-    if (mInstance)
-        return mInstance;
+    // drop the references held by windows still scheduled when we exited
+    FramelessChannel *channel = nullptr;
+    while (mReadyChannels.pop(channel))
+        releaseChannel(channel);
+}
 
-    mInstance = new FramelessWorker;
-    return mInstance;
+void FramelessWorker::setPoolSize(int size)
+{
+    if (!mPool.isEmpty()) {
+        qCWarning(lcFrameless) << "FramelessWorker: the pool is already running with" << mPool.size() << "workers";
+        return;
+    }
+
+    mPoolSize = size;
+}
+
+int FramelessWorker::poolSize()
+{
+    if (!mPool.isEmpty())
+        return mPool.size();
+
+    return mPoolSize > 0 ? mPoolSize : qBound(1, QThread::idealThreadCount() / 2, 4);
+}
+
+FramelessWorker *FramelessWorker::poolWorker()
+{
+    if (mPool.isEmpty()) {
+        const int size = poolSize();
+        for (int i = 0; i < size; ++i)
+            mPool.append(new FramelessWorker);
+
+        for (FramelessWorker *worker : qAsConst(mPool)) {
+            worker->mSiblings = mPool;
+            worker->mSiblings.removeOne(worker);
+            worker->start();
+        }
+    }
+
+    // affinity goes to the worker with the fewest windows
+    FramelessWorker *home = mPool.first();
+    for (FramelessWorker *worker : qAsConst(mPool)) {
+        if (worker->mWindowCount < home->mWindowCount)
+            home = worker;
+    }
+
+    return home;
 }
 
 void FramelessWorker::exit()
 {
     mMutex.lock();
-    mExit = true;
+    mExit.storeRelease(1);
     mCondition.wakeAll();
     mMutex.unlock();
     wait();
 }
 
-void FramelessWorker::postEvent(FramelessEvent *event)
+FramelessChannel *FramelessWorker::registerFrameless(Frameless *frameless)
 {
-    mMutex.lock();
-    mEventQueue.append(event);
-    mCondition.wakeAll();
-    mMutex.unlock();
+    ++mWindowCount;
+    return new FramelessChannel(frameless);
+}
+
+void FramelessWorker::unregisterFrameless(FramelessChannel *channel)
+{
+    --mWindowCount;
+
+    // waits for an in-flight dispatch, queued events are dropped by the worker
+    channel->close();
+    releaseChannel(channel);
+}
+
+void FramelessWorker::postEvent(FramelessChannel *channel, FramelessEvent *event)
+{
+    while (!channel->events.push(event)) {
+        // after aboutToQuit nothing pops the ring again, never wait on it
+        if (mExit.loadAcquire()) {
+            FRAMELESS_STATS(FramelessStats::recordDropped());
+            channel->releaseEvent(event);
+            return;
+        }
+
+        // the worker holds this window's commands back while its command ring
+        // is full and never waits on us, make room so its next turn goes on
+        channel->frameless->drainCommands();
+        QThread::yieldCurrentThread();
+    }
+
+    FRAMELESS_STATS(FramelessStats::recordPosted(channel->events.size()));
+
+    if (channel->scheduled.fetchAndStoreOrdered(1))
+        return;
+
+    channel->ref();
+    while (!mReadyChannels.push(channel))
+        QThread::yieldCurrentThread();
+
+    if (wakeIfParked())
+        return;
+
+    // the home worker is busy with another window, let a parked one steal
+    for (FramelessWorker *sibling : qAsConst(mSiblings)) {
+        if (sibling->wakeIfParked())
+            return;
+    }
+}
+
+void FramelessWorker::sendEvent(FramelessChannel *channel, FramelessEvent *event)
+{
+    FRAMELESS_STATS(const qint64 dequeueNs = FramelessStats::now());
+    FRAMELESS_STATS(FramelessStats::recordStage(FramelessStats::QueueWait, event->inputNs, dequeueNs));
+
+    dispatchEvent(event);
+
+    FRAMELESS_STATS(FramelessStats::recordStage(FramelessStats::Compute, dequeueNs, FramelessStats::now()));
+    channel->releaseEvent(event);
+
+    // inline, the GUI thread is right here to make room
+    while (!publishCommands(channel))
+        channel->frameless->drainCommands();
+    channel->frameless->drainCommands();
 }
 
-FramelessEvent *FramelessWorker::takeEvent()
+FramelessWorker::EventPoolStats FramelessWorker::eventPoolStats()
 {
+    EventPoolStats stats;
+    stats.acquired = FramelessEventPoolCounters::acquired.loadRelaxed();
+    stats.heapAllocations = FramelessEventPoolCounters::heapAllocations.loadRelaxed();
+
+    return stats;
+}
+
+FramelessWorker::Stats FramelessWorker::stats()
+{
+    Stats stats;
+    FRAMELESS_STATS(stats = FramelessStats::snapshot());
+    stats.heapAllocations = FramelessEventPoolCounters::heapAllocations.loadRelaxed();
+
+    return stats;
+}
+
+void FramelessWorker::resetStats()
+{
+    FRAMELESS_STATS(FramelessStats::reset());
+}
+
+void FramelessWorker::setTraceEnabled(bool enabled)
+{
+#ifdef FRAMELESS_ENABLE_STATS
+    FramelessStats::setTraceEnabled(enabled);
+#else
+    Q_UNUSED(enabled);
+#endif
+}
+
+bool FramelessWorker::writeChromeTrace(const QString &fileName)
+{
+#ifdef FRAMELESS_ENABLE_STATS
+    return FramelessStats::writeChromeTrace(fileName);
+#else
+    Q_UNUSED(fileName);
+    return false;
+#endif
+}
+
+bool FramelessWorker::wakeIfParked()
+{
+    if (!mParked.fetchAndStoreOrdered(0))
+        return false;
+
     QMutexLocker locker(&mMutex);
-    while (mEventQueue.isEmpty() && !mExit)
-        mCondition.wait(&mMutex);
+    mCondition.wakeOne();
+    return true;
+}
 
-    FramelessEvent *event = nullptr;
-    if (mEventQueue.length() > 0)
-        event = mEventQueue.takeFirst();
+bool FramelessWorker::popChannel(FramelessChannel *&channel)
+{
+    if (mReadyChannels.pop(channel))
+        return true;
+
+    // a channel is only ever held by one worker, so stealing keeps every
+    // window's events in order while other windows progress in parallel
+    for (FramelessWorker *sibling : qAsConst(mSiblings)) {
+        if (sibling->mReadyChannels.pop(channel))
+            return true;
+    }
 
-    return event;
+    return false;
 }
 
-void FramelessWorker::run()
+FramelessChannel *FramelessWorker::takeChannel()
 {
+    FramelessChannel *channel = nullptr;
+    for (int spin = 0; spin < 64; ++spin) {
+        if (popChannel(channel) || mExit.loadAcquire())
+            return channel;
+
+        QThread::yieldCurrentThread();
+    }
+
+    QMutexLocker locker(&mMutex);
     while (true) {
-        FramelessEvent *event = takeEvent();
-        if (mExit) {
-            delete event;
+        mParked.fetchAndStoreOrdered(1);
+        if (popChannel(channel) || mExit.loadAcquire())
             break;
+
+        mCondition.wait(&mMutex);
+    }
+    mParked.storeRelaxed(0);
+
+    return channel;
+}
+
+void FramelessWorker::processChannel(FramelessChannel *channel)
+{
+    while (true) {
+        // commands a full ring held back go out before this window takes more events
+        bool published = publishStaged(channel);
+
+        FramelessEvent *event = nullptr;
+        int handled = 0;
+        while (published && handled < EventsPerTurn && channel->events.pop(event)) {
+            ++handled;
+            FRAMELESS_STATS(const qint64 dequeueNs = FramelessStats::now());
+
+            // only the newest of a run of moves or hovers matters, everything
+            // in between would just post a stale geometry or cursor
+            FramelessEvent *next = nullptr;
+            while (isCoalescable(event) && channel->events.peek(next) && next->type() == event->type()) {
+                channel->releaseEvent(event);
+                channel->events.pop(event);
+                FRAMELESS_STATS(FramelessStats::recordCoalesced());
+            }
+
+            if (channel->beginDispatch()) {
+                FRAMELESS_STATS(FramelessStats::recordStage(FramelessStats::QueueWait, event->inputNs, dequeueNs));
+                dispatchEvent(event);
+                FRAMELESS_STATS(FramelessStats::recordStage(FramelessStats::Compute, dequeueNs, FramelessStats::now()));
+                channel->endDispatch();
+            } else {
+                FRAMELESS_STATS(FramelessStats::recordDropped());
+            }
+
+            channel->releaseEvent(event);
         }
 
-        switch (event->type()) {
-        case FramelessEvent::FocusIn:
-            focusIn(static_cast<FramelessFocusInEvent *>(event));
-            break;
+        // one aggregated answer per window and batch
+        if (published)
+            published = publishStaged(channel);
+
+        // a window under continuous input goes to the back of the queue after
+        // its turn, still scheduled and with the queue's reference; so does
+        // one whose command ring is full, only the GUI thread makes room there
+        // and it may be busy with another window. A full queue only means it
+        // keeps going here
+        if (!published)
+            QThread::yieldCurrentThread();
+        if ((!published || !channel->events.isEmpty()) && mReadyChannels.push(channel))
+            return;
+        if (!published)
+            continue;
 
-        case FramelessEvent::MouseHover:
-            mouseHover(static_cast<FramelessMouseHoverEvent *>(event));
+        // the GUI thread may have pushed after the last pop while we still
+        // looked scheduled, so take the schedule back if anything is left
+        channel->scheduled.fetchAndStoreOrdered(0);
+        if (channel->events.isEmpty() || channel->scheduled.fetchAndStoreOrdered(1))
             break;
+    }
 
-        case FramelessEvent::MousePress:
-            mousePress(static_cast<FramelessMousePressEvent *>(event));
-            break;
+    releaseChannel(channel);
+}
 
-        case FramelessEvent::MouseMove:
-            mouseMove(static_cast<FramelessMouseMoveEvent *>(event));
-            break;
+void FramelessWorker::postCommand(FramelessEvent *event, FramelessCommand command)
+{
+    FRAMELESS_STATS(command.inputNs = event->inputNs);
 
-        case FramelessEvent::MouseRelease:
-            mouseRelease(static_cast<FramelessMouseReleaseEvent *>(event));
-            break;
+    // only the newest geometry or cursor of a run reaches the GUI thread
+    QVarLengthArray<FramelessCommand, 16> &staged = event->channel->stagedCommands;
+    if (!staged.isEmpty() && command.supersedes(staged.last())) {
+        staged.last() = command;
+        return;
+    }
 
-        case FramelessEvent::Leave:
-            leave(static_cast<FramelessLeaveEvent *>(event));
-            break;
+    staged.append(command);
+}
 
-        default:
+bool FramelessWorker::publishStaged(FramelessChannel *channel)
+{
+    if (channel->stagedCommands.isEmpty())
+        return true;
+
+    // a closed window drains nothing, what it was still owed is dropped
+    if (!channel->beginDispatch()) {
+        FRAMELESS_STATS(FramelessStats::recordDropped());
+        channel->stagedCommands.clear();
+        return true;
+    }
+
+    const bool published = publishCommands(channel);
+    flushCommands(channel);
+    channel->endDispatch();
+    return published;
+}
+
+bool FramelessWorker::publishCommands(FramelessChannel *channel)
+{
+    QVarLengthArray<FramelessCommand, 16> &staged = channel->stagedCommands;
+    int published = 0;
+    while (published < staged.size() && channel->commands.push(staged.at(published)))
+        ++published;
+
+    // the ring is full, the rest stays staged for the window's next turn
+    // instead of holding the worker until the GUI thread drains it
+    staged.remove(0, published);
+    return staged.isEmpty();
+}
+
+void FramelessWorker::flushCommands(FramelessChannel *channel)
+{
+    if (channel->commands.isEmpty() || channel->drainScheduled.fetchAndStoreOrdered(1))
+        return;
+
+    QMetaObject::invokeMethod(channel->frameless, &Frameless::drainCommands, Qt::QueuedConnection);
+}
+
+bool FramelessWorker::isCoalescable(FramelessEvent *event)
+{
+    return event->type() == FramelessEvent::MouseMove
+            || event->type() == FramelessEvent::MouseHover;
+}
+
+void FramelessWorker::dispatchEvent(FramelessEvent *event)
+{
+    switch (event->type()) {
+    case FramelessEvent::FocusIn:
+        focusIn(static_cast<FramelessFocusInEvent *>(event));
+        break;
+
+    case FramelessEvent::MouseHover:
+        mouseHover(static_cast<FramelessMouseHoverEvent *>(event));
+        break;
+
+    case FramelessEvent::MousePress:
+        mousePress(static_cast<FramelessMousePressEvent *>(event));
+        break;
+
+    case FramelessEvent::MouseMove:
+        mouseMove(static_cast<FramelessMouseMoveEvent *>(event));
+        break;
+
+    case FramelessEvent::MouseRelease:
+        mouseRelease(static_cast<FramelessMouseReleaseEvent *>(event));
+        break;
+
+    case FramelessEvent::Leave:
+        leave(static_cast<FramelessLeaveEvent *>(event));
+        break;
+
+    default:
+        break;
+    }
+}
+
+void FramelessWorker::releaseChannel(FramelessChannel *channel)
+{
+    if (channel->deref())
+        return;
+
+    FramelessEvent *event = nullptr;
+    while (channel->events.pop(event))
+        channel->releaseEvent(event);
+
+    delete channel;
+}
+
+void FramelessWorker::run()
+{
+    while (true) {
+        FramelessChannel *channel = takeChannel();
+        if (mExit.loadAcquire()) {
+            // the queue held a reference for this channel, drop it or it leaks
+            if (channel)
+                releaseChannel(channel);
             break;
         }
 
-        delete event;
+        processChannel(channel);
     }
 }
 
 FramelessWorker::DirAndCursorShape FramelessWorker::calcDirAndCursorShape(const QRect &rOrigin, const QPoint &cursorGlobalPoint, int framelessBorder)
 {
-    int x = cursorGlobalPoint.x();
-    int y = cursorGlobalPoint.y();
+    return calcDirAndCursorShape(rOrigin, cursorGlobalPoint,
+                                 QMargins(framelessBorder, framelessBorder, framelessBorder, framelessBorder),
+                                 framelessBorder);
+}
 
-    DirAndCursorShape dirAndShape;
-    if (rOrigin.x() + framelessBorder > x
-            && rOrigin.x() <= x
-            && rOrigin.y() + framelessBorder > y
-            && rOrigin.y() <= y) {
-        dirAndShape.dir = static_cast<int>(Frameless::Direction::TopLeft);
-        dirAndShape.cursorShape = Qt::SizeFDiagCursor;
-    } else if (x > rOrigin.right() - framelessBorder
-              && x <= rOrigin.right()
-              && y > rOrigin.bottom() - framelessBorder
-              && y <= rOrigin.bottom()) {
-        dirAndShape.dir = static_cast<int>(Frameless::Direction::BottomRight);
-        dirAndShape.cursorShape = Qt::SizeFDiagCursor;
-    } else if (x < rOrigin.x() + framelessBorder
-              && x >= rOrigin.x()
-              && y > rOrigin.bottom() - framelessBorder
-              && y <= rOrigin.bottom()) {
-        dirAndShape.dir = static_cast<int>(Frameless::Direction::BottomLeft);
-        dirAndShape.cursorShape = Qt::SizeBDiagCursor;
-    } else if (x <= rOrigin.right()
-              && x >= rOrigin.right() - framelessBorder
-              && y >= rOrigin.y()
-              && y <= rOrigin.y() + framelessBorder) {
-        dirAndShape.dir = static_cast<int>(Frameless::Direction::TopRight);
-        dirAndShape.cursorShape = Qt::SizeBDiagCursor;
-    } else if (x < rOrigin.x() + framelessBorder && x >= rOrigin.x()) {
-        dirAndShape.dir = static_cast<int>(Frameless::Direction::Left);
-        dirAndShape.cursorShape = Qt::SizeHorCursor;
-    } else if (x <= rOrigin.right() && x > rOrigin.right() - framelessBorder) {
-        dirAndShape.dir = static_cast<int>(Frameless::Direction::Right);
-        dirAndShape.cursorShape = Qt::SizeHorCursor;
-    } else if (y >= rOrigin.y() && y < rOrigin.y() + framelessBorder) {
-        dirAndShape.dir = static_cast<int>(Frameless::Direction::Up);
-        dirAndShape.cursorShape = Qt::SizeVerCursor;
-    } else if (y <= rOrigin.bottom() && y > rOrigin.bottom() - framelessBorder) {
-        dirAndShape.dir = static_cast<int>(Frameless::Direction::Down);
-        dirAndShape.cursorShape = Qt::SizeVerCursor;
-    } else {
-        dirAndShape.dir = static_cast<int>(Frameless::Direction::None);
-        dirAndShape.cursorShape = Qt::ArrowCursor;
-    }
+FramelessWorker::DirAndCursorShape FramelessWorker::calcDirAndCursorShape(const QRect &rOrigin, const QPoint &cursorGlobalPoint,
+                                                                          const QMargins &border, int cornerExtent)
+{
+    const int x = cursorGlobalPoint.x();
+    const int y = cursorGlobalPoint.y();
+
+    // inside one edge band the crossing bands widen to the corner extent,
+    // so corners are easier to grab than the edges between them
+    const bool inHorizontalBand = (x >= rOrigin.left() && x < rOrigin.left() + border.left())
+            || (x > rOrigin.right() - border.right() && x <= rOrigin.right());
+    const bool inVerticalBand = (y >= rOrigin.top() && y < rOrigin.top() + border.top())
+            || (y > rOrigin.bottom() - border.bottom() && y <= rOrigin.bottom());
+    const int left = inVerticalBand ? qMax(border.left(), cornerExtent) : border.left();
+    const int right = inVerticalBand ? qMax(border.right(), cornerExtent) : border.right();
+    const int top = inHorizontalBand ? qMax(border.top(), cornerExtent) : border.top();
+    const int bottom = inHorizontalBand ? qMax(border.bottom(), cornerExtent) : border.bottom();
+
+    // the top-right corner has always been hit-tested with closed bounds,
+    // it keeps its own zone bit so results stay identical
+    const int hZone = int(x >= rOrigin.left() && x < rOrigin.left() + left) * NearBand
+            | int(x > rOrigin.right() - right && x <= rOrigin.right()) * FarBand
+            | int(x >= rOrigin.right() - right && x <= rOrigin.right()) * CornerBand;
+    const int vZone = int(y >= rOrigin.top() && y < rOrigin.top() + top) * NearBand
+            | int(y > rOrigin.bottom() - bottom && y <= rOrigin.bottom()) * FarBand
+            | int(y >= rOrigin.top() && y <= rOrigin.top() + top) * CornerBand;
+
+    const HitEntry &entry = HitTable[hZone][vZone];
 
+    DirAndCursorShape dirAndShape;
+    dirAndShape.dir = static_cast<int>(entry.dir);
+    dirAndShape.cursorShape = entry.cursorShape;
     return dirAndShape;
 }
 
-QRect FramelessWorker::calcPositionRect(int dir, QWidget *target, const QRect &rOrigin, const QPoint &gloPoint)
+QRect FramelessWorker::calcPositionRect(int dir, const QSize &minimumSize, const QRect &rOrigin, const QPoint &gloPoint)
 {
     QRect rMove(rOrigin);
 
     switch (static_cast<Frameless::Direction>(dir)) {
     case Frameless::Direction::Left: {
-        if (rOrigin.right() - gloPoint.x() <= target->minimumWidth()) {
+        if (rOrigin.right() - gloPoint.x() <= minimumSize.width()) {
             rMove.setX(rOrigin.left());
         } else {
             rMove.setX(gloPoint.x());
@@ -162,7 +533,7 @@ QRect FramelessWorker::calcPositionRect(int dir, QWidget *target, const QRect &r
         break;
 
     case Frameless::Direction::Right: {
-        if (gloPoint.x() - rOrigin.left() <= target->minimumWidth()) {
+        if (gloPoint.x() - rOrigin.left() <= minimumSize.width()) {
             rMove.setX(rOrigin.left());
         } else {
             rMove.setX(rOrigin.left());
@@ -172,7 +543,7 @@ QRect FramelessWorker::calcPositionRect(int dir, QWidget *target, const QRect &r
         break;
 
     case Frameless::Direction::Up: {
-        if (rOrigin.bottom() - gloPoint.y() <= target->minimumHeight()) {
+        if (rOrigin.bottom() - gloPoint.y() <= minimumSize.height()) {
             rMove.setY(rOrigin.top());
         } else {
             rMove.setY(gloPoint.y());
@@ -182,7 +553,7 @@ QRect FramelessWorker::calcPositionRect(int dir, QWidget *target, const QRect &r
         break;
 
     case Frameless::Direction::Down: {
-        if (gloPoint.y() - rOrigin.top() <= target->minimumHeight()) {
+        if (gloPoint.y() - rOrigin.top() <= minimumSize.height()) {
             rMove.setY(rOrigin.top());
         } else {
             rMove.setY(rOrigin.top());
@@ -192,13 +563,13 @@ QRect FramelessWorker::calcPositionRect(int dir, QWidget *target, const QRect &r
         break;
 
     case Frameless::Direction::TopLeft: {
-        if (rOrigin.right() - gloPoint.x() <= target->minimumWidth()) {
+        if (rOrigin.right() - gloPoint.x() <= minimumSize.width()) {
             rMove.setX(rOrigin.left());
         } else {
             rMove.setX(gloPoint.x());
         }
 
-        if (rOrigin.bottom() - gloPoint.y() <= target->minimumHeight()) {
+        if (rOrigin.bottom() - gloPoint.y() <= minimumSize.height()) {
             rMove.setY(rOrigin.top());
         } else {
             rMove.setY(gloPoint.y());
@@ -207,14 +578,14 @@ QRect FramelessWorker::calcPositionRect(int dir, QWidget *target, const QRect &r
         break;
 
     case Frameless::Direction::TopRight: {
-        if (gloPoint.x() - rOrigin.left() <= target->minimumWidth()) {
+        if (gloPoint.x() - rOrigin.left() <= minimumSize.width()) {
             rMove.setX(rOrigin.left());
         } else {
             rMove.setX(rOrigin.left());
             rMove.setWidth(gloPoint.x() - rOrigin.left());
         }
 
-        if (rOrigin.bottom() - gloPoint.y() <= target->minimumHeight()) {
+        if (rOrigin.bottom() - gloPoint.y() <= minimumSize.height()) {
             rMove.setY(rOrigin.top());
         } else {
             rMove.setY(gloPoint.y());
@@ -223,13 +594,13 @@ QRect FramelessWorker::calcPositionRect(int dir, QWidget *target, const QRect &r
         break;
 
     case Frameless::Direction::BottomLeft: {
-        if (rOrigin.right() - gloPoint.x() <= target->minimumWidth()) {
+        if (rOrigin.right() - gloPoint.x() <= minimumSize.width()) {
             rMove.setX(rOrigin.left());
         } else {
             rMove.setX(gloPoint.x());
         }
 
-        if (gloPoint.y() - rOrigin.top() <= target->minimumHeight()) {
+        if (gloPoint.y() - rOrigin.top() <= minimumSize.height()) {
             rMove.setY(rOrigin.top());
         } else {
             rMove.setY(rOrigin.top());
@@ -239,14 +610,14 @@ QRect FramelessWorker::calcPositionRect(int dir, QWidget *target, const QRect &r
         break;
 
     case Frameless::Direction::BottomRight: {
-        if (gloPoint.x() - rOrigin.left() <= target->minimumWidth()) {
+        if (gloPoint.x() - rOrigin.left() <= minimumSize.width()) {
             rMove.setX(rOrigin.left());
         } else {
             rMove.setX(rOrigin.left());
             rMove.setWidth(gloPoint.x() - rOrigin.left());
         }
 
-        if (gloPoint.y() - rOrigin.top() <= target->minimumHeight()) {
+        if (gloPoint.y() - rOrigin.top() <= minimumSize.height()) {
             rMove.setY(rOrigin.top());
         } else {
             rMove.setY(rOrigin.top());
@@ -262,133 +633,366 @@ QRect FramelessWorker::calcPositionRect(int dir, QWidget *target, const QRect &r
     return rMove;
 }
 
-QRect FramelessWorker::calcOriginRect(QWidget *taget)
+QPoint FramelessWorker::snapMovePosition(const FramelessGeometry &geometry, const QPoint &topLeft)
 {
-    const QRect &rect = taget->frameGeometry();
-    QPoint tl = rect.topLeft();
-    QPoint rb = rect.bottomRight();
+    if (!geometry.snapIndex || !geometry.isWindow || geometry.isMaximized())
+        return topLeft;
+
+    const int margin = geometry.layoutMargin;
+    const QRect content = QRect(topLeft, geometry.originRect.size()).adjusted(margin, margin, -margin, -margin);
+    const int right = content.left() + content.width();
+    const int bottom = content.top() + content.height();
+    const int threshold = geometry.snapThreshold;
+
+    // whichever of the two edges per axis is closer to a line wins
+    int dx = 0;
+    int dLeft = 0;
+    int dRight = 0;
+    const bool left = geometry.snapIndex->snapVertical(content.left(), content.top(), bottom, threshold, &dLeft);
+    const bool rightSnap = geometry.snapIndex->snapVertical(right, content.top(), bottom, threshold, &dRight);
+    if (left && (!rightSnap || qAbs(dLeft) <= qAbs(dRight)))
+        dx = dLeft;
+    else if (rightSnap)
+        dx = dRight;
+
+    int dy = 0;
+    int dTop = 0;
+    int dBottom = 0;
+    const bool top = geometry.snapIndex->snapHorizontal(content.top(), content.left(), right, threshold, &dTop);
+    const bool bottomSnap = geometry.snapIndex->snapHorizontal(bottom, content.left(), right, threshold, &dBottom);
+    if (top && (!bottomSnap || qAbs(dTop) <= qAbs(dBottom)))
+        dy = dTop;
+    else if (bottomSnap)
+        dy = dBottom;
+
+    return topLeft + QPoint(dx, dy);
+}
 
-    QWidget *window = taget->window();
-    if (window && window != taget) {
-        tl = taget->mapTo(window, taget->mapFromGlobal(tl));
-        rb = taget->mapTo(window, taget->mapFromGlobal(rb));
+QRect FramelessWorker::snapResizeRect(const FramelessGeometry &geometry, int dir, const QRect &rect)
+{
+    if (!geometry.snapIndex || !geometry.isWindow)
+        return rect;
+
+    const int margin = geometry.layoutMargin;
+    const int threshold = geometry.snapThreshold;
+    const Frameless::Direction direction = static_cast<Frameless::Direction>(dir);
+    QRect content = rect.adjusted(margin, margin, -margin, -margin);
+    int delta = 0;
+
+    // only the edges under the pointer move
+    switch (direction) {
+    case Frameless::Direction::Left:
+    case Frameless::Direction::TopLeft:
+    case Frameless::Direction::BottomLeft:
+        if (geometry.snapIndex->snapVertical(content.left(), content.top(), content.bottom() + 1, threshold, &delta))
+            content.setLeft(content.left() + delta);
+        break;
+    case Frameless::Direction::Right:
+    case Frameless::Direction::TopRight:
+    case Frameless::Direction::BottomRight:
+        if (geometry.snapIndex->snapVertical(content.right() + 1, content.top(), content.bottom() + 1, threshold, &delta))
+            content.setRight(content.right() + delta);
+        break;
+    default:
+        break;
     }
 
-    return QRect(tl, rb);
+    switch (direction) {
+    case Frameless::Direction::Up:
+    case Frameless::Direction::TopLeft:
+    case Frameless::Direction::TopRight:
+        if (geometry.snapIndex->snapHorizontal(content.top(), content.left(), content.right() + 1, threshold, &delta))
+            content.setTop(content.top() + delta);
+        break;
+    case Frameless::Direction::Down:
+    case Frameless::Direction::BottomLeft:
+    case Frameless::Direction::BottomRight:
+        if (geometry.snapIndex->snapHorizontal(content.bottom() + 1, content.left(), content.right() + 1, threshold, &delta))
+            content.setBottom(content.bottom() + delta);
+        break;
+    default:
+        break;
+    }
+
+    const QRect rSnapped = content.adjusted(-margin, -margin, margin, margin);
+    if (rSnapped.width() < geometry.minimumSize.width() || rSnapped.height() < geometry.minimumSize.height())
+        return rect;
+
+    return rSnapped;
 }
 
-QPoint FramelessWorker::calcFakeGlobalPos(QWidget *taget, const QPoint &gloPoint)
+bool FramelessWorker::tileRect(const FramelessGeometry &geometry, const QPoint &cursorGlobalPoint, QRect *rect)
 {
-    QPoint gp = gloPoint;
-    QWidget *window = taget->window();
-    if (window && window != taget) {
-        gp = taget->mapTo(window, taget->mapFromGlobal(gloPoint));
+    if (!geometry.windowTiling || geometry.snapThreshold <= 0 || !geometry.isWindow
+            || geometry.isMaximized() || geometry.isFullScreen())
+        return false;
+
+    const FramelessScreenInfo *screen = geometry.screenAt(cursorGlobalPoint);
+    if (!screen)
+        return false;
+
+    // released against a side gives a half, against a corner a quarter
+    const QRect &area = screen->availableGeometry;
+    const int threshold = geometry.snapThreshold;
+    const bool left = cursorGlobalPoint.x() < area.left() + threshold;
+    const bool right = cursorGlobalPoint.x() > area.right() - threshold;
+    const bool top = cursorGlobalPoint.y() < area.top() + threshold;
+    const bool bottom = cursorGlobalPoint.y() > area.bottom() - threshold;
+    if (!left && !right)
+        return false;
+
+    QRect tile = area;
+    tile.setWidth(area.width() / 2);
+    if (right)
+        tile.moveLeft(area.left() + area.width() - tile.width());
+
+    if (top || bottom) {
+        tile.setHeight(area.height() / 2);
+        if (bottom)
+            tile.moveTop(area.top() + area.height() - tile.height());
     }
 
-    return gp;
+    const int margin = geometry.layoutMargin;
+    tile.adjust(-margin, -margin, margin, margin);
+    if (tile.width() < geometry.minimumSize.width() || tile.height() < geometry.minimumSize.height()
+            || tile.width() > geometry.maximumSize.width() || tile.height() > geometry.maximumSize.height())
+        return false;
+
+    *rect = tile;
+    return true;
+}
+
+QPoint FramelessWorker::clampMovePosition(const FramelessGeometry &geometry, const QPoint &topLeft, const QPoint &cursorGlobalPoint)
+{
+    if (!geometry.isWindow)
+        return topLeft;
+
+    // the content top never goes above the work area, the caption stays reachable
+    const FramelessScreenInfo *screen = geometry.screenAt(cursorGlobalPoint);
+    if (!screen)
+        return topLeft;
+
+    return QPoint(topLeft.x(), qMax(topLeft.y(), screen->availableGeometry.top() - geometry.layoutMargin));
+}
+
+QRect FramelessWorker::clampResizeRect(const FramelessGeometry &geometry, int dir, const QRect &rect, const QPoint &cursorGlobalPoint)
+{
+    QRect rClamped = rect;
+    const Frameless::Direction direction = static_cast<Frameless::Direction>(dir);
+    const bool leftEdge = direction == Frameless::Direction::Left
+            || direction == Frameless::Direction::TopLeft
+            || direction == Frameless::Direction::BottomLeft;
+    const bool topEdge = direction == Frameless::Direction::Up
+            || direction == Frameless::Direction::TopLeft
+            || direction == Frameless::Direction::TopRight;
+
+    // grow no further than maximumSize, keeping the opposite edge in place
+    if (rClamped.width() > geometry.maximumSize.width()) {
+        if (leftEdge)
+            rClamped.setLeft(rClamped.right() - geometry.maximumSize.width() + 1);
+        else
+            rClamped.setWidth(geometry.maximumSize.width());
+    }
+
+    if (rClamped.height() > geometry.maximumSize.height()) {
+        if (topEdge)
+            rClamped.setTop(rClamped.bottom() - geometry.maximumSize.height() + 1);
+        else
+            rClamped.setHeight(geometry.maximumSize.height());
+    }
+
+    if (!topEdge || !geometry.isWindow)
+        return rClamped;
+
+    const FramelessScreenInfo *screen = geometry.screenAt(cursorGlobalPoint);
+    const int top = screen ? screen->availableGeometry.top() - geometry.layoutMargin : rClamped.top();
+    if (rClamped.top() < top && rClamped.bottom() - top + 1 >= geometry.minimumSize.height())
+        rClamped.setTop(top);
+
+    return rClamped;
 }
 
 void FramelessWorker::focusIn(FramelessFocusInEvent *event)
 {
+    const FramelessGeometry &geometry = event->channel->geometry.read();
     if (!event->canWindowResize
-            || event->target->isFullScreen() || event->target->isMaximized())
+            || geometry.isFullScreen() || geometry.isMaximized())
         return;
 
-    DirAndCursorShape dirAndShape = calcDirAndCursorShape(calcOriginRect(event->target),
-                                                          calcFakeGlobalPos(event->target, event->target->cursor().pos()),
-                                                          event->frameless->framelessBorder());
-    QMetaObject::invokeMethod(event->frameless, "setCursorByFrameless", Qt::QueuedConnection,
-                              Q_ARG(int, int(dirAndShape.cursorShape)));
+    DirAndCursorShape dirAndShape = calcDirAndCursorShape(geometry.originRect,
+                                                          geometry.mapFromGlobal(event->globalCursorPositon),
+                                                          geometry.border, geometry.cornerExtent);
+    FramelessCommand command(FramelessCommand::SetCursor);
+    command.cursorShape = int(dirAndShape.cursorShape);
+    postCommand(event, command);
     event->frameless->setDirection(static_cast<Frameless::Direction>(dirAndShape.dir));
 }
 
 void FramelessWorker::mouseHover(FramelessMouseHoverEvent *event)
 {
+    const FramelessGeometry &geometry = event->channel->geometry.read();
     if (event->frameless->leftMouseButtonPressed()
             || !event->canWindowResize
-            || event->target->isFullScreen())
+            || geometry.isFullScreen())
         return;
 
-    QWidget *window = event->target->window();
-    if (!window || (window == event->target && window->isMaximized()))
+    if (geometry.isWindow && geometry.isMaximized())
         return;
 
-    QRect rect = calcOriginRect(event->target);
-    if (QLayout *layout = event->target->layout()) {
-        int margin = layout->margin();
-        rect.adjust(margin, margin, -margin, -margin);
-    }
+    QRect rect = geometry.originRect;
+    rect.adjust(geometry.layoutMargin, geometry.layoutMargin, -geometry.layoutMargin, -geometry.layoutMargin);
 
-    DirAndCursorShape dirAndShape = calcDirAndCursorShape(rect, calcFakeGlobalPos(event->target, event->globalCursorPositon),
-                                                          event->frameless->framelessBorder());
-    event->frameless->setDirection(static_cast<Frameless::Direction>(dirAndShape.dir));
-    QMetaObject::invokeMethod(event->frameless, "setCursorByFrameless", Qt::QueuedConnection,
-                              Q_ARG(int, int(dirAndShape.cursorShape)));
+    DirAndCursorShape dirAndShape = calcDirAndCursorShape(rect, geometry.mapFromGlobal(event->globalCursorPositon),
+                                                          geometry.border, geometry.cornerExtent);
+    const Frameless::Direction dir = static_cast<Frameless::Direction>(dirAndShape.dir);
+    if (dir == event->frameless->direction())
+        return;
+
+    event->frameless->setDirection(dir);
+
+    FramelessCommand command(FramelessCommand::SetCursor);
+    command.cursorShape = int(dirAndShape.cursorShape);
+    postCommand(event, command);
 }
 
 
 void FramelessWorker::mousePress(FramelessMousePressEvent *event)
 {
     event->frameless->setLeftMouseButtonPressed(true);
+    event->channel->dragPredictor.reset();
 
     if (event->frameless->direction() == Frameless::Direction::None) {
-        event->frameless->setCurrentCanWindowMove(event->canWindowMove);
-
-        if (event->canWindowMove && (!event->target->isFullScreen() && !event->target->isMaximized())) {
-            event->frameless->setDragPosition(event->globalCursorPositon - event->target->frameGeometry().topLeft());
-            QMetaObject::invokeMethod(event->frameless, "readyToStartMove", Qt::QueuedConnection,
-                                      Q_ARG(int, int(Qt::SizeAllCursor)));
+        const FramelessGeometry &geometry = event->channel->geometry.read();
+        const bool canWindowMove = geometry.hitMap
+                ? geometry.hitMap->isCaption(event->globalCursorPositon - geometry.clientOrigin, event->canWindowMove)
+                : event->canWindowMove;
+        event->frameless->setCurrentCanWindowMove(canWindowMove);
+        event->channel->restoredByDrag = false;
+
+        if (canWindowMove && (!geometry.isFullScreen() && !geometry.isMaximized())) {
+            event->frameless->setDragPosition(event->globalCursorPositon - geometry.frameTopLeft);
+            FramelessCommand command(FramelessCommand::StartMove);
+            command.cursorShape = int(Qt::SizeAllCursor);
+            postCommand(event, command);
+        } else {
+            // nothing native starts, a bit left by an earlier gesture would
+            // keep this one from moving or restoring the window
+            event->frameless->setAcceptSystemMoving(false);
+            event->frameless->setAcceptSystemResize(false);
+
+            // remembered to tell a drag from a click before restoring
+            if (canWindowMove && geometry.isMaximized())
+                event->frameless->setDragPosition(event->globalCursorPositon - geometry.frameTopLeft);
         }
     } else {
-        QMetaObject::invokeMethod(event->frameless, "accpetSystemResize", Qt::QueuedConnection);
-        event->target->releaseMouse();
+        postCommand(event, FramelessCommand(FramelessCommand::StartResize));
     }
 }
 
 void FramelessWorker::mouseMove(FramelessMouseMoveEvent *event)
 {
+    const FramelessGeometry &geometry = event->channel->geometry.read();
     QPoint gloPoint = event->globalCursorPositon;
 
     if (event->frameless->leftMouseButtonPressed()
             && (event->frameless->direction() == Frameless::Direction::None)
             && event->frameless->currentCanWindowMove()) {
-        if (event->target->isMaximized() || event->target->isFullScreen() || event->frameless->acceptSystemMoving()) {
-            // event->target->showNormal();
-
-            // double xRatio = event->globalX() * 1.0 / event->target->width();
-            // double yRatio = event->globalY() * 1.0 / event->target->height();
-            // int widgetX = event->target->width() * xRatio;
-            // int widgetY = event->target->height() * yRatio;
+        if (geometry.isFullScreen())
+            return;
 
-            // event->target->move(event->globalX() - widgetX, event->globalY() - widgetY);
-            // event->target->layout()->setMargin(10);
+        // until the restored geometry is published, keep moving the restored window
+        if (geometry.isMaximized() && !event->channel->restoredByDrag)
+            return restoreFromMaximized(event, geometry);
 
-            // dragPosition = event->globalPos() - event->target->frameGeometry().topLeft();
+        if (event->frameless->acceptSystemMoving())
             return;
+
+        QPoint pos = event->globalCursorPositon;
+        if (geometry.predictionHorizon > 0) {
+            FramelessDragPredictor &predictor = event->channel->dragPredictor;
+            predictor.addSample(pos, event->timestamp);
+            pos += predictor.predict(geometry.predictionHorizon, geometry.predictionClamp);
         }
 
-        QMetaObject::invokeMethod(event->frameless, "moveByFrameless", Qt::QueuedConnection,
-                                  Q_ARG(QPoint, event->globalCursorPositon - event->frameless->dragPosition()));
+        const QPoint topLeft = snapMovePosition(geometry, pos - event->frameless->dragPosition());
+        FramelessCommand command(FramelessCommand::Move);
+        command.pos = clampMovePosition(geometry, topLeft, event->globalCursorPositon);
+        postCommand(event, command);
         return;
     }
 
     if (!event->frameless->acceptSystemResize() && event->frameless->leftMouseButtonPressed() && event->canWindowResize) {
-        if (event->target->isMaximized() || event->target->isFullScreen())
+        if (geometry.isMaximized() || geometry.isFullScreen())
             return;
 
-        gloPoint = calcFakeGlobalPos(event->target, gloPoint);
+        gloPoint = geometry.mapFromGlobal(gloPoint);
 
-        const QRect &rect = calcPositionRect(static_cast<int>(event->frameless->direction()),
-                                             event->target, calcOriginRect(event->target), gloPoint);
-        QMetaObject::invokeMethod(event->frameless, "setGeometryByFrameless", Qt::QueuedConnection,
-                                  Q_ARG(QRect, rect));
+        const int dir = static_cast<int>(event->frameless->direction());
+        const QRect &rect = snapResizeRect(geometry, dir, calcPositionRect(dir, geometry.minimumSize, geometry.originRect, gloPoint));
+        FramelessCommand command(FramelessCommand::SetGeometry);
+        command.rect = clampResizeRect(geometry, dir, rect, event->globalCursorPositon);
+        postCommand(event, command);
     }
 }
 
+void FramelessWorker::restoreFromMaximized(FramelessMouseMoveEvent *event, const FramelessGeometry &geometry)
+{
+    const QPoint &cursor = event->globalCursorPositon;
+    const QPoint pressPoint = geometry.frameTopLeft + event->frameless->dragPosition();
+    if (!geometry.isWindow || geometry.normalGeometry.isEmpty()
+            || (cursor - pressPoint).manhattanLength() < DragRestoreDistance)
+        return;
+
+    // keep the cursor at the same relative x and the same height on the caption
+    const QRect &maximized = geometry.originRect;
+    const QRect &normal = geometry.normalGeometry;
+    const int margin = geometry.normalLayoutMargin;
+    const qreal xRatio = qreal(cursor.x() - maximized.left()) / qMax(1, maximized.width());
+    const int yOffset = qMin(cursor.y() - maximized.top(), normal.height() - 2 * margin - 1);
+
+    QRect rect(QPoint(cursor.x() - margin - qRound(xRatio * (normal.width() - 2 * margin)),
+                      cursor.y() - margin - qMax(0, yOffset)),
+               normal.size());
+    rect.moveTopLeft(clampMovePosition(geometry, rect.topLeft(), cursor));
+
+    FramelessCommand command(FramelessCommand::Restore);
+    command.rect = rect;
+    postCommand(event, command);
+
+    event->frameless->setDragPosition(cursor - rect.topLeft());
+    event->channel->restoredByDrag = true;
+}
+
 void FramelessWorker::mouseRelease(FramelessMouseReleaseEvent *event)
 {
-    QMetaObject::invokeMethod(event->frameless, "unsetCursorByFrameless", Qt::QueuedConnection);
+    const FramelessGeometry &geometry = event->channel->geometry.read();
+
+    // a predicted move ends exactly under the pointer
+    FramelessDragPredictor &predictor = event->channel->dragPredictor;
+    if (predictor.hasSample && !event->frameless->acceptSystemMoving()) {
+        const QPoint topLeft = snapMovePosition(geometry, predictor.lastPos - event->frameless->dragPosition());
+        FramelessCommand command(FramelessCommand::Move);
+        command.pos = clampMovePosition(geometry, topLeft, predictor.lastPos);
+        postCommand(event, command);
+    }
+    predictor.reset();
+
+    const bool softwareMove = event->frameless->leftMouseButtonPressed()
+            && event->frameless->direction() == Frameless::Direction::None
+            && event->frameless->currentCanWindowMove()
+            && !event->frameless->acceptSystemMoving();
+    QRect tile;
+    if (softwareMove && tileRect(geometry, event->globalCursorPositon, &tile)) {
+        FramelessCommand command(FramelessCommand::SetGeometry);
+        command.rect = tile;
+        postCommand(event, command);
+    }
+
+    postCommand(event, FramelessCommand(FramelessCommand::UnsetCursor));
+    postCommand(event, FramelessCommand(FramelessCommand::FinishMoveResize));
     event->frameless->setLeftMouseButtonPressed(false);
+    event->frameless->setAcceptSystemMoving(false);
+    event->frameless->setAcceptSystemResize(false);
     event->frameless->setDirection(Frameless::Direction::None);
     event->frameless->setDragPosition({0, 0});
 }
@@ -399,5 +1003,5 @@ void FramelessWorker::leave(FramelessLeaveEvent *event)
         return;
 
     event->frameless->setDirection(Frameless::Direction::None);
-    QMetaObject::invokeMethod(event->frameless, "unsetCursorByFrameless", Qt::QueuedConnection);
+    postCommand(event, FramelessCommand(FramelessCommand::UnsetCursor));
 }
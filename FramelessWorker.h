@@ -1,29 +1,79 @@
 #ifndef FRAMELESSWORKER_H
 #define FRAMELESSWORKER_H
 
+#include "FramelessChannel.h"
+#include "FramelessMpmcQueue.h"
+#include "FramelessStats.h"
+#include "FramelessWorkerEvent.h"
+
 #include <QMutex>
 #include <QThread>
+#include <QVector>
 #include <QWaitCondition>
 
-class FramelessEvent;
-class FramelessLeaveEvent;
-class FramelessFocusInEvent;
-class FramelessMouseMoveEvent;
-class FramelessMousePressEvent;
-class FramelessMouseHoverEvent;
-class FramelessMouseReleaseEvent;
 class FramelessWorker : public QThread
 {
     Q_OBJECT
 public:
-    static FramelessWorker *instance();
-    void postEvent(FramelessEvent *event);
+    ~FramelessWorker() override;
+
+    // shared pool, every window gets a home worker and idle workers steal
+    static void setPoolSize(int size);
+    static int poolSize();
+    static FramelessWorker *poolWorker();
+
+    FramelessChannel *registerFrameless(Frameless *frameless);
+    void unregisterFrameless(FramelessChannel *channel);
+    void postEvent(FramelessChannel *channel, FramelessEvent *event);
+    void sendEvent(FramelessChannel *channel, FramelessEvent *event);
+
+    struct EventPoolStats
+    {
+        quint64 acquired = 0;
+        quint64 heapAllocations = 0;
+    };
+    static EventPoolStats eventPoolStats();
+
+    // event pool counters are always kept; the queue counters and stage
+    // timings stay zero unless built with FRAMELESS_ENABLE_STATS, and
+    // tracing is a no-op without it
+    using Stats = FramelessStats::Snapshot;
+    static Stats stats();
+    static void resetStats();
+    static void setTraceEnabled(bool enabled);
+    static bool writeChromeTrace(const QString &fileName);
+
+    // pure hit test and resize math, usable without a running worker
+    struct DirAndCursorShape
+    {
+        int dir = -1;
+        Qt::CursorShape cursorShape = Qt::ArrowCursor;
+    };
+    static DirAndCursorShape calcDirAndCursorShape(const QRect &rOrigin, const QPoint &cursorGlobalPoint, int framelessBorder);
+    static DirAndCursorShape calcDirAndCursorShape(const QRect &rOrigin, const QPoint &cursorGlobalPoint,
+                                                   const QMargins &border, int cornerExtent);
+    static QRect calcPositionRect(int dir, const QSize &minimumSize, const QRect &rOrigin, const QPoint &gloPoint);
+    static QPoint snapMovePosition(const FramelessGeometry &geometry, const QPoint &topLeft);
+    static QRect snapResizeRect(const FramelessGeometry &geometry, int dir, const QRect &rect);
+    static bool tileRect(const FramelessGeometry &geometry, const QPoint &cursorGlobalPoint, QRect *rect);
+    static QPoint clampMovePosition(const FramelessGeometry &geometry, const QPoint &topLeft, const QPoint &cursorGlobalPoint);
+    static QRect clampResizeRect(const FramelessGeometry &geometry, int dir, const QRect &rect, const QPoint &cursorGlobalPoint);
 
 public Q_SLOTS:
     void exit();
 
 protected:
-    FramelessEvent *takeEvent();
+    FramelessChannel *takeChannel();
+    bool popChannel(FramelessChannel *&channel);
+    bool wakeIfParked();
+    void processChannel(FramelessChannel *channel);
+    void dispatchEvent(FramelessEvent *event);
+    static bool isCoalescable(FramelessEvent *event);
+    void postCommand(FramelessEvent *event, FramelessCommand command);
+    bool publishStaged(FramelessChannel *channel);
+    bool publishCommands(FramelessChannel *channel);
+    void flushCommands(FramelessChannel *channel);
+    void releaseChannel(FramelessChannel *channel);
     void run() override;
 
     void focusIn(FramelessFocusInEvent *event);
@@ -32,26 +82,24 @@ protected:
     void mouseMove(FramelessMouseMoveEvent *event);
     void mouseRelease(FramelessMouseReleaseEvent *event);
     void leave(FramelessLeaveEvent *event);
-
-    struct DirAndCursorShape
-    {
-        int dir = -1;
-        Qt::CursorShape cursorShape = Qt::ArrowCursor;
-    };
-    static DirAndCursorShape calcDirAndCursorShape(const QRect &rOrigin, const QPoint &cursorGlobalPoint, int framelessBorder);
-    static QRect calcPositionRect(int dir, QWidget *target, const QRect &rOrigin, const QPoint &gloPoint);
-    static QRect calcOriginRect(QWidget *taget);
-    static QPoint calcFakeGlobalPos(QWidget *taget, const QPoint &gloPoint);
+    void restoreFromMaximized(FramelessMouseMoveEvent *event, const FramelessGeometry &geometry);
 
 private:
+    friend class Frameless;
     explicit FramelessWorker(QObject *parent = nullptr);
 
 private:
-    static FramelessWorker *    mInstance;
-    bool                        mExit = false;
-    QList<FramelessEvent *>     mEventQueue;
+    static QVector<FramelessWorker *>   mPool;
+    static int                          mPoolSize;
+
+    QVector<FramelessWorker *>  mSiblings;
+    int                         mWindowCount = 0;
+    QAtomicInt                  mExit;
+    QAtomicInt                  mParked;
     QWaitCondition              mCondition;
     QMutex                      mMutex;
+
+    FramelessMpmcQueue<FramelessChannel *, 256> mReadyChannels;
 };
 
 #endif // FRAMELESSWORKER_H
@@ -1,5 +1,8 @@
 #include "FramelessWorkerEvent.h"
 
+QAtomicInteger<quint64> FramelessEventPoolCounters::acquired;
+QAtomicInteger<quint64> FramelessEventPoolCounters::heapAllocations;
+
 FramelessEvent::FramelessEvent(EventType type)
     : mEventType(type)
 {
@@ -1,10 +1,14 @@
 #ifndef FRAMELESSWORKEREVENT_H
 #define FRAMELESSWORKEREVENT_H
 
+#include "FramelessRingBuffer.h"
+#include "FramelessStats.h"
+
 #include <QPoint>
 
 class Frameless;
 class QWidget;
+struct FramelessChannel;
 struct FramelessEvent
 {
     enum EventType {
@@ -23,6 +27,8 @@ struct FramelessEvent
     EventType type();
     QWidget *target = nullptr;
     Frameless *frameless = nullptr;
+    FramelessChannel *channel = nullptr;
+    FRAMELESS_STATS(qint64 inputNs = 0;)
 
 private:
     EventType mEventType = EventType::UnkonwEvent;
@@ -31,13 +37,16 @@ private:
 struct FramelessFocusInEvent : public FramelessEvent
 {
     FramelessFocusInEvent();
+    static constexpr int PoolSize = 8;
 
+    QPoint globalCursorPositon;
     bool canWindowResize = true;
 };
 
 struct FramelessMouseHoverEvent : public FramelessEvent
 {
     FramelessMouseHoverEvent();
+    static constexpr int PoolSize = 64;
 
     QPoint globalCursorPositon;
 
@@ -47,6 +56,7 @@ struct FramelessMouseHoverEvent : public FramelessEvent
 struct FramelessMousePressEvent : public FramelessEvent
 {
     FramelessMousePressEvent();
+    static constexpr int PoolSize = 8;
 
     QPoint globalCursorPositon;
     bool canWindowMove = false;
@@ -55,23 +65,77 @@ struct FramelessMousePressEvent : public FramelessEvent
 struct FramelessMouseMoveEvent : public FramelessEvent
 {
     FramelessMouseMoveEvent();
+    static constexpr int PoolSize = 64;
 
     QPoint globalCursorPositon;
+    qint64 timestamp = 0;   // microseconds, monotonic per window
     bool canWindowResize = true;
 };
 
 struct FramelessMouseReleaseEvent : public FramelessEvent
 {
     FramelessMouseReleaseEvent();
+    static constexpr int PoolSize = 8;
+
+    QPoint globalCursorPositon;
 };
 
 struct FramelessLeaveEvent : public FramelessEvent
 {
     FramelessLeaveEvent();
+    static constexpr int PoolSize = 8;
 };
 
 struct FramelessWindowDeactivateEvent : FramelessEvent
 {
     FramelessWindowDeactivateEvent();
 };
+
+// Process-wide counters of all event pools.
+struct FramelessEventPoolCounters
+{
+    static QAtomicInteger<quint64> acquired;
+    static QAtomicInteger<quint64> heapAllocations;
+};
+
+// Preallocated slots for one event type, recycled between the GUI thread
+// (acquire) and the worker thread (release). Falls back to the heap when empty.
+template<typename T, int Size = T::PoolSize>
+class FramelessEventPool
+{
+public:
+    FramelessEventPool()
+    {
+        for (T &slot : mSlots)
+            mFree.push(&slot);
+    }
+
+    T *acquire()
+    {
+        FramelessEventPoolCounters::acquired.fetchAndAddRelaxed(1);
+
+        T *event = nullptr;
+        if (mFree.pop(event)) {
+            *event = T();
+            return event;
+        }
+
+        FramelessEventPoolCounters::heapAllocations.fetchAndAddRelaxed(1);
+        return new T;
+    }
+
+    void release(T *event)
+    {
+        if (event >= mSlots && event < mSlots + Size) {
+            mFree.push(event);
+            return;
+        }
+
+        delete event;
+    }
+
+private:
+    T                               mSlots[Size];
+    FramelessRingBuffer<T *, Size>  mFree;
+};
 #endif // FRAMELESSWORKEREVENT_H
@@ -0,0 +1,549 @@
+#include "FramelessShadow.h"
+#include "FramelessWidget.h"
+#include "FramelessWorker.h"
+
+#include <QtTest>
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QFrame>
+#include <QGraphicsEffect>
+#include <QHBoxLayout>
+#include <QHoverEvent>
+#include <QMouseEvent>
+#include <QMutex>
+#include <QPainter>
+#include <QThread>
+#include <QWaitCondition>
+
+namespace {
+
+class BenchWindow : public FramelessWidget
+{
+public:
+    explicit BenchWindow(Frameless::ExecutionPolicy policy = Frameless::ExecutionPolicy::SharedWorker)
+        : FramelessWidget(nullptr, policy)
+    {
+        resize(400, 300);
+        QHBoxLayout *mainLayout = new QHBoxLayout(this);
+        mainLayout->setMargin(0);
+        mainLayout->addWidget(new QFrame(this));
+
+        frameless()->setCanWindowMove(true);
+    }
+
+    Frameless *frameless() const
+    {
+        return findChild<Frameless *>();
+    }
+
+protected:
+    bool canWindowMove() override
+    {
+        return true;
+    }
+};
+
+// a point well inside the caption, clear of every resize band
+QPoint captionPoint(const QWidget *window)
+{
+    return QPoint(window->width() / 2, 40);
+}
+
+// through the widget like real input, so FramelessWidget::event and its
+// canWindowMove() cache are part of what is measured
+void sendMouse(BenchWindow *window, QEvent::Type type, const QPoint &globalPos, Qt::MouseButtons buttons)
+{
+    const Qt::MouseButton button = type == QEvent::MouseMove ? Qt::NoButton : Qt::LeftButton;
+    QMouseEvent event(type, window->mapFromGlobal(globalPos), globalPos, button, buttons, Qt::NoModifier);
+    QCoreApplication::sendEvent(window, &event);
+}
+
+void sendHover(BenchWindow *window, const QPoint &pos, const QPoint &oldPos)
+{
+    QHoverEvent event(QEvent::HoverMove, pos, oldPos);
+    QCoreApplication::sendEvent(window, &event);
+}
+
+// the mutex and wakeAll queue FramelessWorker used before the per-window
+// channels, kept to compare post-to-dispatch latency against
+class LockedQueueWorker : public QThread
+{
+public:
+    void post(qint64 postedNs)
+    {
+        mMutex.lock();
+        mQueue.append(postedNs);
+        mCondition.wakeAll();
+        mMutex.unlock();
+    }
+
+    void stop()
+    {
+        mMutex.lock();
+        mExit = true;
+        mCondition.wakeAll();
+        mMutex.unlock();
+        wait();
+    }
+
+    QAtomicInteger<quint64> dispatched;
+    QAtomicInteger<quint64> totalNs;
+
+protected:
+    void run() override
+    {
+        while (true) {
+            QMutexLocker locker(&mMutex);
+            while (mQueue.isEmpty() && !mExit)
+                mCondition.wait(&mMutex);
+
+            if (mExit)
+                break;
+
+            const qint64 postedNs = mQueue.takeFirst();
+            locker.unlock();
+
+            totalNs.fetchAndAddRelaxed(quint64(FramelessStats::now() - postedNs));
+            dispatched.fetchAndAddRelease(1);
+        }
+    }
+
+private:
+    QMutex mMutex;
+    QWaitCondition mCondition;
+    QList<qint64> mQueue;
+    bool mExit = false;
+};
+
+void addWindowCounts()
+{
+    QTest::addColumn<int>("windows");
+
+    QTest::newRow("1 window") << 1;
+    QTest::newRow("10 windows") << 10;
+    QTest::newRow("100 windows") << 100;
+}
+
+}
+
+class BenchFrameless : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void cleanup();
+
+    void postToDispatch_data();
+    void postToDispatch();
+    void targetEvent_data();
+    void targetEvent();
+    void dispatchLatency_data();
+    void dispatchLatency();
+    void inputToCursor_data();
+    void inputToCursor();
+    void calcDirAndCursorShape_data();
+    void calcDirAndCursorShape();
+    void calcPositionRect_data();
+    void calcPositionRect();
+    void commitsPerSecond_data();
+    void commitsPerSecond();
+    void shadowPaint_data();
+    void shadowPaint();
+
+private:
+    void createWindows(int count, Frameless::ExecutionPolicy policy = Frameless::ExecutionPolicy::SharedWorker);
+    void hoverAll();
+    void pressAll();
+    void moveAll(int step);
+    void releaseAll();
+    void waitForWorkers();
+
+    QVector<BenchWindow *> mWindows;
+    QVector<QPoint> mPressPoints;
+};
+
+void BenchFrameless::cleanup()
+{
+    qDeleteAll(mWindows);
+    mWindows.clear();
+    mPressPoints.clear();
+}
+
+void BenchFrameless::createWindows(int count, Frameless::ExecutionPolicy policy)
+{
+    for (int i = 0; i < count; ++i) {
+        BenchWindow *window = new BenchWindow(policy);
+        window->move(20 + (i % 10) * 8, 20 + (i / 10) * 8);
+        window->show();
+        mWindows.append(window);
+    }
+
+    for (BenchWindow *window : qAsConst(mWindows))
+        QTest::qWaitForWindowExposed(window);
+}
+
+// the pointer comes in over the right border and crosses the client area
+// to the caption, most of these hovers take the client-area skip
+void BenchFrameless::hoverAll()
+{
+    for (BenchWindow *window : qAsConst(mWindows)) {
+        const QPoint caption = captionPoint(window);
+        QPoint last(window->width() - 1, caption.y());
+        for (int x = last.x(); x >= caption.x(); x -= 8) {
+            const QPoint pos(x, caption.y());
+            sendHover(window, pos, last);
+            last = pos;
+        }
+    }
+}
+
+void BenchFrameless::pressAll()
+{
+    mPressPoints.clear();
+    for (BenchWindow *window : qAsConst(mWindows)) {
+        mPressPoints.append(window->mapToGlobal(captionPoint(window)));
+        sendMouse(window, QEvent::MouseButtonPress, mPressPoints.last(), Qt::LeftButton);
+    }
+}
+
+// every step moves each window by one pixel, back and forth around the press
+void BenchFrameless::moveAll(int step)
+{
+    for (int i = 0; i < mWindows.size(); ++i)
+        sendMouse(mWindows.at(i), QEvent::MouseMove, mPressPoints.at(i) + QPoint(step % 2, 0), Qt::LeftButton);
+}
+
+void BenchFrameless::releaseAll()
+{
+    for (int i = 0; i < mWindows.size(); ++i)
+        sendMouse(mWindows.at(i), QEvent::MouseButtonRelease, mPressPoints.at(i), Qt::NoButton);
+}
+
+void BenchFrameless::waitForWorkers()
+{
+    for (BenchWindow *window : qAsConst(mWindows))
+        window->frameless()->waitForWorker();
+}
+
+void BenchFrameless::postToDispatch_data()
+{
+    QTest::addColumn<bool>("channel");
+
+    QTest::newRow("mutex queue") << false;
+    QTest::newRow("channel") << true;
+}
+
+// mean time from posting one event to a parked worker picking it up
+void BenchFrameless::postToDispatch()
+{
+#ifndef FRAMELESS_ENABLE_STATS
+    QSKIP("built without FRAMELESS_ENABLE_STATS");
+#else
+    QFETCH(bool, channel);
+    const int events = 10000;
+
+    if (!channel) {
+        LockedQueueWorker worker;
+        worker.start();
+        for (int i = 0; i < events; ++i) {
+            worker.post(FramelessStats::now());
+            while (worker.dispatched.loadAcquire() <= quint64(i))
+                QThread::yieldCurrentThread();
+        }
+        worker.stop();
+
+        QTest::setBenchmarkResult(qreal(worker.totalNs.loadRelaxed()) / events, QTest::WalltimeNanoseconds);
+        return;
+    }
+
+    createWindows(1);
+    BenchWindow *window = mWindows.first();
+    const QPoint pos = window->mapToGlobal(captionPoint(window));
+    FramelessWorker::resetStats();
+
+    for (int i = 0; i < events; ++i) {
+        sendMouse(window, QEvent::MouseMove, pos + QPoint(i % 2, 0), Qt::NoButton);
+        window->frameless()->waitForWorker();
+    }
+
+    const FramelessStats::StageStats &queueWait = FramelessWorker::stats().stages[FramelessStats::QueueWait];
+    QVERIFY(queueWait.count >= quint64(events));
+    QTest::setBenchmarkResult(qreal(queueWait.totalNs) / queueWait.count, QTest::WalltimeNanoseconds);
+#endif
+}
+
+void BenchFrameless::targetEvent_data()
+{
+    addWindowCounts();
+}
+
+// GUI-thread cost of one pointer visit per window, hovers from the border to
+// the caption, press, 64 moves and release, including the wait for the
+// workers to hand their geometry back
+void BenchFrameless::targetEvent()
+{
+    QFETCH(int, windows);
+    createWindows(windows);
+
+    QBENCHMARK {
+        hoverAll();
+        pressAll();
+        for (int step = 1; step <= 64; ++step)
+            moveAll(step);
+        releaseAll();
+
+        waitForWorkers();
+    }
+}
+
+void BenchFrameless::dispatchLatency_data()
+{
+    addWindowCounts();
+}
+
+// mean time from targetEvent to the worker dequeuing the event
+void BenchFrameless::dispatchLatency()
+{
+#ifndef FRAMELESS_ENABLE_STATS
+    QSKIP("built without FRAMELESS_ENABLE_STATS");
+#endif
+    QFETCH(int, windows);
+    createWindows(windows);
+    FramelessWorker::resetStats();
+
+    for (int round = 0; round < 16; ++round) {
+        pressAll();
+        for (int step = 1; step <= 64; ++step)
+            moveAll(step);
+        releaseAll();
+
+        waitForWorkers();
+    }
+
+    const FramelessWorker::Stats stats = FramelessWorker::stats();
+    const FramelessStats::StageStats &queueWait = stats.stages[FramelessStats::QueueWait];
+    QVERIFY(queueWait.count > 0);
+
+    qInfo("posted %llu, coalesced %llu, queue high water %llu, max wait %llu ns",
+          stats.posted, stats.coalesced, stats.queueHighWater, queueWait.maxNs);
+    QTest::setBenchmarkResult(qreal(queueWait.totalNs) / queueWait.count, QTest::WalltimeNanoseconds);
+}
+
+void BenchFrameless::inputToCursor_data()
+{
+    QTest::addColumn<int>("policy");
+
+    QTest::newRow("inline") << int(Frameless::ExecutionPolicy::Inline);
+    QTest::newRow("shared worker") << int(Frameless::ExecutionPolicy::SharedWorker);
+    QTest::newRow("dedicated worker") << int(Frameless::ExecutionPolicy::DedicatedWorker);
+}
+
+// time from a hover crossing into the right border until the resize cursor
+// is set, or crossing back until it is gone
+void BenchFrameless::inputToCursor()
+{
+    QFETCH(int, policy);
+    createWindows(1, static_cast<Frameless::ExecutionPolicy>(policy));
+
+    BenchWindow *window = mWindows.first();
+    const int margin = window->layout()->contentsMargins().right();
+    const QPoint inside(window->width() / 2, window->height() / 2);
+    const QPoint border(window->width() - margin - 2, window->height() / 2);
+    const int rounds = 1000;
+
+    qint64 totalNs = 0;
+    QElapsedTimer timer;
+    for (int i = 0; i < rounds; ++i) {
+        const bool toBorder = i % 2 == 0;
+        QHoverEvent event(QEvent::HoverMove, toBorder ? border : inside, toBorder ? inside : border);
+
+        timer.start();
+        window->frameless()->targetEvent(&event);
+
+        // the worker policies answer through a queued drain
+        while (bool(QApplication::overrideCursor()) != toBorder) {
+            QVERIFY2(timer.elapsed() < 1000, "the cursor never changed");
+            QCoreApplication::processEvents();
+        }
+        totalNs += timer.nsecsElapsed();
+    }
+
+    QTest::setBenchmarkResult(qreal(totalNs) / rounds, QTest::WalltimeNanoseconds);
+}
+
+void BenchFrameless::calcDirAndCursorShape_data()
+{
+    QTest::addColumn<QPoint>("point");
+
+    QTest::newRow("inside") << QPoint(200, 150);
+    QTest::newRow("edge") << QPoint(2, 150);
+    QTest::newRow("corner") << QPoint(397, 297);
+}
+
+// ns per hit test, the point wobbles so nothing is hoisted out of the loop
+void BenchFrameless::calcDirAndCursorShape()
+{
+    QFETCH(QPoint, point);
+
+    const QRect rect(0, 0, 400, 300);
+    const QMargins border(5, 5, 5, 5);
+    const int operations = 1 << 20;
+    volatile int sink = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < operations; ++i)
+        sink += FramelessWorker::calcDirAndCursorShape(rect, point + QPoint(i & 1, 0), border, 5).dir;
+
+    QTest::setBenchmarkResult(qreal(timer.nsecsElapsed()) / operations, QTest::WalltimeNanoseconds);
+    Q_UNUSED(sink);
+}
+
+void BenchFrameless::calcPositionRect_data()
+{
+    QTest::addColumn<int>("dir");
+
+    QTest::newRow("right") << int(Frameless::Direction::Right);
+    QTest::newRow("topLeft") << int(Frameless::Direction::TopLeft);
+    QTest::newRow("bottomRight") << int(Frameless::Direction::BottomRight);
+}
+
+// ns per resize rect
+void BenchFrameless::calcPositionRect()
+{
+    QFETCH(int, dir);
+
+    const QRect rect(100, 100, 400, 300);
+    const QSize minimumSize(120, 80);
+    const int operations = 1 << 20;
+    volatile int sink = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < operations; ++i)
+        sink += FramelessWorker::calcPositionRect(dir, minimumSize, rect, QPoint(60 + (i & 63), 40 + (i & 31))).width();
+
+    QTest::setBenchmarkResult(qreal(timer.nsecsElapsed()) / operations, QTest::WalltimeNanoseconds);
+    Q_UNUSED(sink);
+}
+
+void BenchFrameless::commitsPerSecond_data()
+{
+    QTest::addColumn<int>("windows");
+    QTest::addColumn<int>("mode");
+
+    const int immediate = int(Frameless::CommitMode::Immediate);
+    const int framePaced = int(Frameless::CommitMode::FramePaced);
+    QTest::newRow("1 window, immediate") << 1 << immediate;
+    QTest::newRow("1 window, frame paced") << 1 << framePaced;
+    QTest::newRow("10 windows, immediate") << 10 << immediate;
+    QTest::newRow("10 windows, frame paced") << 10 << framePaced;
+    QTest::newRow("100 windows, immediate") << 100 << immediate;
+    QTest::newRow("100 windows, frame paced") << 100 << framePaced;
+}
+
+// geometry commits per window and second under a move flood, the frame
+// paced rows should settle at the screen's refresh rate
+void BenchFrameless::commitsPerSecond()
+{
+    QFETCH(int, windows);
+    QFETCH(int, mode);
+    createWindows(windows);
+
+    quint64 commitsBefore = 0;
+    for (BenchWindow *window : qAsConst(mWindows)) {
+        window->frameless()->setGeometryCommitMode(static_cast<Frameless::CommitMode>(mode));
+        commitsBefore += window->frameless()->geometryCommitCount();
+    }
+
+    pressAll();
+    QElapsedTimer timer;
+    timer.start();
+    for (int step = 1; timer.elapsed() < 500; ++step) {
+        moveAll(step);
+
+        // queued drains and the frame timers run here
+        QCoreApplication::processEvents();
+    }
+    const qint64 elapsedNs = timer.nsecsElapsed();
+
+    quint64 commitsAfter = 0;
+    for (BenchWindow *window : qAsConst(mWindows))
+        commitsAfter += window->frameless()->geometryCommitCount();
+
+    releaseAll();
+    waitForWorkers();
+
+    const qreal commits = qreal(commitsAfter - commitsBefore) / windows;
+    QTest::setBenchmarkResult(commits * 1e9 / elapsedNs, QTest::FramesPerSecond);
+}
+
+void BenchFrameless::shadowPaint_data()
+{
+    QTest::addColumn<QSize>("size");
+    QTest::addColumn<bool>("ninePatch");
+
+    QTest::newRow("1080p, nine-patch") << QSize(1920, 1080) << true;
+    QTest::newRow("1080p, blur effect") << QSize(1920, 1080) << false;
+    QTest::newRow("4K, nine-patch") << QSize(3840, 2160) << true;
+    QTest::newRow("4K, blur effect") << QSize(3840, 2160) << false;
+}
+
+// one full repaint of a shadowed window, the cached nine-patch around plain
+// content against the drop shadow effect the content used to carry
+void BenchFrameless::shadowPaint()
+{
+    QFETCH(QSize, size);
+    QFETCH(bool, ninePatch);
+
+    const int radius = 10;
+    const QColor color(63, 63, 63, 180);
+
+    QWidget window;
+    QHBoxLayout *mainLayout = new QHBoxLayout(&window);
+    mainLayout->setMargin(radius);
+    QFrame *content = new QFrame(&window);
+    content->setAutoFillBackground(true);
+    mainLayout->addWidget(content);
+
+    if (!ninePatch) {
+        QGraphicsDropShadowEffect *effect = new QGraphicsDropShadowEffect(&window);
+        effect->setBlurRadius(20);
+        effect->setOffset(0);
+        content->setGraphicsEffect(effect);
+    }
+
+    window.resize(size);
+    mainLayout->activate();
+
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+
+    // the nine-patch is blurred on first use, the repaints after it are what counts
+    if (ninePatch) {
+        QPainter painter(&image);
+        FramelessShadow::paint(&painter, content->geometry(), radius, color);
+    }
+
+    QBENCHMARK {
+        image.fill(Qt::transparent);
+        if (ninePatch) {
+            QPainter painter(&image);
+            FramelessShadow::paint(&painter, content->geometry(), radius, color);
+        }
+        window.render(&image, QPoint(), QRegion(), QWidget::DrawChildren);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // no display needed, and every run sees the same screen
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    BenchFrameless bench;
+
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_frameless.moc"
@@ -0,0 +1,18 @@
+# Runs offscreen: ./bench_frameless [-iterations n] [function[:tag]]
+
+QT += testlib
+
+CONFIG += console benchmark
+CONFIG -= app_bundle
+
+TARGET = bench_frameless
+
+# dispatch latency is read back from the worker's stage counters
+DEFINES += FRAMELESS_ENABLE_STATS
+
+# no application around, build against the stand-in headers
+CONFIG += frameless_stubs
+include(../../frameless.pri)
+
+SOURCES += \
+    bench_frameless.cpp
@@ -0,0 +1,56 @@
+# Frameless window support, shared by the demo, the tests and the benchmarks.
+
+QT       += core gui
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+CONFIG += c++17
+
+# Input-to-geometry latency counters and chrome://tracing dumps, see FramelessStats.h.
+#DEFINES += FRAMELESS_ENABLE_STATS
+
+# Hot-path debug output in the "frameless" logging category, see FramelessLogging.h.
+#DEFINES += FRAMELESS_ENABLE_LOGGING
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+# The tests and benchmarks build without the application, CONFIG += frameless_stubs
+# puts stand-ins for AppGlobalInfo.h, MachineHelper.h and gadgets/WarnMessageLabel.h
+# on the include path; the application ships the real headers.
+frameless_stubs {
+    INCLUDEPATH += $$PWD/stubs
+    HEADERS += \
+        $$PWD/stubs/AppGlobalInfo.h \
+        $$PWD/stubs/MachineHelper.h \
+        $$PWD/stubs/gadgets/WarnMessageLabel.h
+}
+
+SOURCES += \
+    $$PWD/Frameless.cpp \
+    $$PWD/FramelessChannel.cpp \
+    $$PWD/FramelessHitMap.cpp \
+    $$PWD/FramelessScreenTopology.cpp \
+    $$PWD/FramelessShadow.cpp \
+    $$PWD/FramelessSnapIndex.cpp \
+    $$PWD/FramelessWidget.cpp \
+    $$PWD/FramelessWorker.cpp \
+    $$PWD/FramelessWorkerEvent.cpp
+
+contains(DEFINES, FRAMELESS_ENABLE_STATS): SOURCES += $$PWD/FramelessStats.cpp
+
+HEADERS += \
+    $$PWD/Frameless.h \
+    $$PWD/FramelessChannel.h \
+    $$PWD/FramelessHitMap.h \
+    $$PWD/FramelessLogging.h \
+    $$PWD/FramelessMpmcQueue.h \
+    $$PWD/FramelessRingBuffer.h \
+    $$PWD/FramelessScreenTopology.h \
+    $$PWD/FramelessShadow.h \
+    $$PWD/FramelessSnapIndex.h \
+    $$PWD/FramelessStats.h \
+    $$PWD/FramelessTripleBuffer.h \
+    $$PWD/FramelessWidget.h \
+    $$PWD/FramelessWorker.h \
+    $$PWD/FramelessWorkerEvent.h
@@ -0,0 +1,6 @@
+#ifndef APPGLOBALINFO_H
+#define APPGLOBALINFO_H
+
+// stand-in for the application header, Frameless includes it but uses nothing from it
+
+#endif // APPGLOBALINFO_H
@@ -0,0 +1,23 @@
+#ifndef WARNMESSAGELABEL_H
+#define WARNMESSAGELABEL_H
+
+#include <QLabel>
+
+// stand-in for the application's prompt label, a plain hidden label
+class WarnMessageLabel : public QLabel
+{
+public:
+    explicit WarnMessageLabel(QWidget *parent = nullptr)
+        : QLabel(parent)
+    {
+        hide();
+    }
+
+    void showPromptMsg(const QString &msg)
+    {
+        setText(msg);
+        show();
+    }
+};
+
+#endif // WARNMESSAGELABEL_H
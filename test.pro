@@ -1,26 +1,14 @@
-QT       += core gui
-
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
-
-CONFIG += c++17
-
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(frameless.pri)
+
 SOURCES += \
-    Frameless.cpp \
-    FramelessWidget.cpp \
-    FramelessWorker.cpp \
-    FramelessWorkerEvent.cpp \
     main.cpp \
     Widget.cpp
 
 HEADERS += \
-    Frameless.h \
-    FramelessWidget.h \
-    FramelessWorker.h \
-    FramelessWorkerEvent.h \
     Widget.h
 
 # Default rules for deployment.
@@ -0,0 +1,5 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    tst_framelesshittest \
+    tst_framelessreplay
@@ -0,0 +1,116 @@
+#include "Frameless.h"
+#include "FramelessWorker.h"
+
+#include <QtTest>
+
+namespace {
+
+// the if/else cascade the border hit test was before the zone table,
+// kept verbatim as the reference the table has to reproduce
+FramelessWorker::DirAndCursorShape referenceHitTest(const QRect &rOrigin, const QPoint &cursorGlobalPoint, int framelessBorder)
+{
+    int x = cursorGlobalPoint.x();
+    int y = cursorGlobalPoint.y();
+
+    FramelessWorker::DirAndCursorShape dirAndShape;
+    if (rOrigin.x() + framelessBorder > x
+            && rOrigin.x() <= x
+            && rOrigin.y() + framelessBorder > y
+            && rOrigin.y() <= y) {
+        dirAndShape.dir = static_cast<int>(Frameless::Direction::TopLeft);
+        dirAndShape.cursorShape = Qt::SizeFDiagCursor;
+    } else if (x > rOrigin.right() - framelessBorder
+              && x <= rOrigin.right()
+              && y > rOrigin.bottom() - framelessBorder
+              && y <= rOrigin.bottom()) {
+        dirAndShape.dir = static_cast<int>(Frameless::Direction::BottomRight);
+        dirAndShape.cursorShape = Qt::SizeFDiagCursor;
+    } else if (x < rOrigin.x() + framelessBorder
+              && x >= rOrigin.x()
+              && y > rOrigin.bottom() - framelessBorder
+              && y <= rOrigin.bottom()) {
+        dirAndShape.dir = static_cast<int>(Frameless::Direction::BottomLeft);
+        dirAndShape.cursorShape = Qt::SizeBDiagCursor;
+    } else if (x <= rOrigin.right()
+              && x >= rOrigin.right() - framelessBorder
+              && y >= rOrigin.y()
+              && y <= rOrigin.y() + framelessBorder) {
+        dirAndShape.dir = static_cast<int>(Frameless::Direction::TopRight);
+        dirAndShape.cursorShape = Qt::SizeBDiagCursor;
+    } else if (x < rOrigin.x() + framelessBorder && x >= rOrigin.x()) {
+        dirAndShape.dir = static_cast<int>(Frameless::Direction::Left);
+        dirAndShape.cursorShape = Qt::SizeHorCursor;
+    } else if (x <= rOrigin.right() && x > rOrigin.right() - framelessBorder) {
+        dirAndShape.dir = static_cast<int>(Frameless::Direction::Right);
+        dirAndShape.cursorShape = Qt::SizeHorCursor;
+    } else if (y >= rOrigin.y() && y < rOrigin.y() + framelessBorder) {
+        dirAndShape.dir = static_cast<int>(Frameless::Direction::Up);
+        dirAndShape.cursorShape = Qt::SizeVerCursor;
+    } else if (y <= rOrigin.bottom() && y > rOrigin.bottom() - framelessBorder) {
+        dirAndShape.dir = static_cast<int>(Frameless::Direction::Down);
+        dirAndShape.cursorShape = Qt::SizeVerCursor;
+    } else {
+        dirAndShape.dir = static_cast<int>(Frameless::Direction::None);
+        dirAndShape.cursorShape = Qt::ArrowCursor;
+    }
+
+    return dirAndShape;
+}
+
+}
+
+class TestFramelessHitTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void matchesReference_data();
+    void matchesReference();
+};
+
+void TestFramelessHitTest::matchesReference_data()
+{
+    QTest::addColumn<int>("border");
+
+    for (int border = 0; border <= 12; ++border)
+        QTest::newRow(qPrintable(QStringLiteral("border %1").arg(border))) << border;
+}
+
+// every point in and two pixels around every rect up to 24x24, at a few
+// origins, so bands wider than the rect and overlapping corners are covered
+void TestFramelessHitTest::matchesReference()
+{
+    QFETCH(int, border);
+
+    const int origins[] = { -7, 0, 5 };
+    quint64 cases = 0;
+    for (int left : origins) {
+        for (int top : origins) {
+            for (int width = 1; width <= 24; ++width) {
+                for (int height = 1; height <= 24; ++height) {
+                    const QRect rect(left, top, width, height);
+                    for (int x = rect.left() - 2; x <= rect.right() + 2; ++x) {
+                        for (int y = rect.top() - 2; y <= rect.bottom() + 2; ++y) {
+                            const QPoint point(x, y);
+                            const FramelessWorker::DirAndCursorShape expected = referenceHitTest(rect, point, border);
+                            const FramelessWorker::DirAndCursorShape actual = FramelessWorker::calcDirAndCursorShape(rect, point, border);
+                            if (actual.dir != expected.dir || actual.cursorShape != expected.cursorShape) {
+                                QFAIL(qPrintable(QStringLiteral("rect (%1, %2 %3x%4) point (%5, %6): dir %7, cursor %8, expected dir %9, cursor %10")
+                                                 .arg(left).arg(top).arg(width).arg(height).arg(x).arg(y)
+                                                 .arg(actual.dir).arg(int(actual.cursorShape))
+                                                 .arg(expected.dir).arg(int(expected.cursorShape))));
+                            }
+                            ++cases;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    QCOMPARE(cases, quint64(9 * 396 * 396));
+}
+
+QTEST_APPLESS_MAIN(TestFramelessHitTest)
+
+#include "tst_framelesshittest.moc"
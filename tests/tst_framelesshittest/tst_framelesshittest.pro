@@ -0,0 +1,13 @@
+QT += testlib
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_framelesshittest
+
+# no application around, build against the stand-in headers
+CONFIG += frameless_stubs
+include(../../frameless.pri)
+
+SOURCES += \
+    tst_framelesshittest.cpp
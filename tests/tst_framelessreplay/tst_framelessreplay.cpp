@@ -0,0 +1,543 @@
+#include "FramelessWidget.h"
+
+#include <QtTest>
+#include <QApplication>
+#include <QFrame>
+#include <QHBoxLayout>
+#include <QHoverEvent>
+#include <QMouseEvent>
+#include <QRandomGenerator>
+
+namespace {
+
+constexpr int ReplayWindows = 4;
+constexpr int MinimumReplaySize = 150;
+constexpr int MaximumReplaySize = 600;
+
+struct ReplayStep
+{
+    enum Type {
+        Hover,
+        Press,
+        Move,
+        Release,
+        Leave
+    };
+
+    Type type;
+    int window;
+    QPoint pos;     // relative to the window's initial top-left
+};
+
+using ReplayTrace = QVector<ReplayStep>;
+
+struct ReplayResult
+{
+    QVector<QRect> geometries;
+    int cursorShape = -1;
+};
+
+class ReplayWindow : public FramelessWidget
+{
+public:
+    explicit ReplayWindow(Frameless::ExecutionPolicy policy)
+        : FramelessWidget(nullptr, policy)
+    {
+        QHBoxLayout *mainLayout = new QHBoxLayout(this);
+        mainLayout->setMargin(0);
+        mainLayout->addWidget(new QFrame(this));
+    }
+
+    Frameless *frameless() const
+    {
+        return findChild<Frameless *>();
+    }
+
+protected:
+    bool canWindowMove() override
+    {
+        return true;
+    }
+
+    // no shadow margin, the border bands start at the window edge
+    bool withDropShadow() override
+    {
+        return false;
+    }
+};
+
+QRect initialGeometry(int window)
+{
+    return QRect(100 + 60 * window, 100 + 40 * window, 300, 200);
+}
+
+QVector<QRect> initialGeometries()
+{
+    QVector<QRect> rects;
+    for (int i = 0; i < ReplayWindows; ++i)
+        rects.append(initialGeometry(i));
+
+    return rects;
+}
+
+// one of the caption or the eight border zones of a w x h window
+QPoint zonePoint(int zone, const QSize &size, QRandomGenerator &random)
+{
+    const int w = size.width();
+    const int h = size.height();
+    switch (zone) {
+    case 1: return QPoint(1, h / 2);
+    case 2: return QPoint(w - 2, h / 2);
+    case 3: return QPoint(w / 2, 1);
+    case 4: return QPoint(w / 2, h - 2);
+    case 5: return QPoint(1, 1);
+    case 6: return QPoint(w - 2, 1);
+    case 7: return QPoint(1, h - 2);
+    case 8: return QPoint(w - 2, h - 2);
+    default:
+        return QPoint(w / 4 + random.bounded(w / 2), h / 4 + random.bounded(h / 2));
+    }
+}
+
+// pointer travel along one axis that keeps the resized extent within bounds
+int boundedDelta(QRandomGenerator &random, int extent, int start, bool nearEdge)
+{
+    int lo = -100;
+    int hi = 100;
+    if (nearEdge) {
+        lo = qMax(lo, extent - start - MaximumReplaySize);
+        hi = qMin(hi, extent - start - MinimumReplaySize);
+    } else {
+        lo = qMax(lo, MinimumReplaySize - start);
+        hi = qMin(hi, MaximumReplaySize - start);
+    }
+
+    return lo + random.bounded(hi - lo + 1);
+}
+
+// pointer travel that keeps a moved window's top-left in [0, 0, limit]
+int boundedMove(QRandomGenerator &random, int origin, int limit)
+{
+    const int lo = qMax(-100, -origin);
+    const int hi = qMin(100, limit - origin);
+
+    return lo + random.bounded(hi - lo + 1);
+}
+
+// a hover, click, caption drag or border resize on one window, ending with
+// the pointer leaving it; rect follows the gesture the way the window should,
+// the worker's clamps never engage because nothing ends above the screen top
+ReplayTrace randomGesture(QRandomGenerator &random, int window, QRect &rect)
+{
+    ReplayTrace gesture;
+    const QPoint offset = rect.topLeft() - initialGeometry(window).topLeft();
+    const int zone = random.bounded(9);
+    const QPoint start = zonePoint(zone, rect.size(), random);
+    gesture.append({ ReplayStep::Hover, window, offset + start });
+
+    switch (random.bounded(3)) {
+    case 0:
+        for (int i = random.bounded(4); i > 0; --i)
+            gesture.append({ ReplayStep::Hover, window, offset + zonePoint(random.bounded(9), rect.size(), random) });
+        break;
+
+    case 1:
+        gesture.append({ ReplayStep::Press, window, offset + start });
+        gesture.append({ ReplayStep::Release, window, offset + start });
+        break;
+
+    default: {
+        const bool left = zone == 1 || zone == 5 || zone == 7;
+        const bool right = zone == 2 || zone == 6 || zone == 8;
+        const bool top = zone == 3 || zone == 5 || zone == 6;
+        const bool bottom = zone == 4 || zone == 7 || zone == 8;
+        const bool caption = !left && !right && !top && !bottom;
+
+        QPoint delta;
+        gesture.append({ ReplayStep::Press, window, offset + start });
+        for (int i = 1 + random.bounded(40); i > 0; --i) {
+            if (caption) {
+                delta = QPoint(boundedMove(random, rect.left(), 500), boundedMove(random, rect.top(), 400));
+            } else {
+                delta.setX(left || right ? boundedDelta(random, rect.width(), start.x(), left) : random.bounded(-100, 101));
+                delta.setY(top || bottom ? boundedDelta(random, rect.height(), start.y(), top) : random.bounded(-100, 101));
+                if (top)
+                    delta.setY(qMax(delta.y(), -(rect.top() + start.y())));
+            }
+            gesture.append({ ReplayStep::Move, window, offset + start + delta });
+        }
+        gesture.append({ ReplayStep::Release, window, offset + start + delta });
+
+        // the edge under the pointer follows it, the opposite one stays put
+        if (caption)
+            rect.translate(delta);
+        if (left)
+            rect.setLeft(rect.left() + start.x() + delta.x());
+        if (right)
+            rect.setWidth(start.x() + delta.x());
+        if (top)
+            rect.setTop(rect.top() + start.y() + delta.y());
+        if (bottom)
+            rect.setHeight(start.y() + delta.y());
+    }
+        break;
+    }
+
+    gesture.append({ ReplayStep::Leave, window, QPoint() });
+    return gesture;
+}
+
+// gestures on up to every window at once, their steps interleaved in short
+// bursts; expected gets where each window has to end up
+ReplayTrace randomTrace(quint32 seed, QVector<QRect> *expected)
+{
+    QRandomGenerator random(seed);
+    QVector<QRect> rects = initialGeometries();
+    QVector<ReplayTrace> gestures(ReplayWindows);
+    QVector<int> next(ReplayWindows, 0);
+    ReplayTrace trace;
+    int started = 0;
+
+    for (;;) {
+        bool busy = false;
+        for (int i = 0; i < ReplayWindows; ++i)
+            busy = busy || next.at(i) < gestures.at(i).size();
+        if (!busy && started == 24)
+            break;
+
+        const int window = random.bounded(ReplayWindows);
+        if (next.at(window) == gestures.at(window).size()) {
+            if (started == 24)
+                continue;
+
+            gestures[window] = randomGesture(random, window, rects[window]);
+            next[window] = 0;
+            ++started;
+        }
+
+        for (int i = 1 + random.bounded(4); i > 0 && next.at(window) < gestures.at(window).size(); --i)
+            trace.append(gestures.at(window).at(next[window]++));
+    }
+
+    *expected = rects;
+    return trace;
+}
+
+// the same drag on every window, one move of each in turn
+ReplayTrace concurrentDrags(int moves, QVector<QRect> *expected)
+{
+    ReplayTrace trace;
+    for (int window = 0; window < ReplayWindows; ++window) {
+        trace.append({ ReplayStep::Hover, window, QPoint(150, 100) });
+        trace.append({ ReplayStep::Press, window, QPoint(150, 100) });
+    }
+
+    const QPoint last(150 + moves % 97, 100 + moves % 53);
+    for (int i = 1; i <= moves; ++i) {
+        for (int window = 0; window < ReplayWindows; ++window)
+            trace.append({ ReplayStep::Move, window, QPoint(150 + i % 97, 100 + i % 53) });
+    }
+
+    *expected = initialGeometries();
+    for (int window = 0; window < ReplayWindows; ++window) {
+        trace.append({ ReplayStep::Release, window, last });
+        (*expected)[window].translate(last - QPoint(150, 100));
+    }
+
+    return trace;
+}
+
+}
+
+Q_DECLARE_METATYPE(ReplayStep)
+Q_DECLARE_METATYPE(Frameless::ExecutionPolicy)
+
+class TestFramelessReplay : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void replay_data();
+    void replay();
+    void restoreAfterNativeMove_data();
+    void restoreAfterNativeMove();
+
+private:
+    ReplayResult replayTrace(const ReplayTrace &trace, Frameless::ExecutionPolicy policy);
+};
+
+void TestFramelessReplay::replay_data()
+{
+    QTest::addColumn<ReplayTrace>("trace");
+    QTest::addColumn<QVector<QRect>>("expected");   // every window, worked out apart from Frameless
+    QTest::addColumn<bool>("interleaved");          // gestures overlap across windows
+
+    ReplayTrace drag = { { ReplayStep::Hover, 0, QPoint(150, 100) }, { ReplayStep::Press, 0, QPoint(150, 100) } };
+    for (int i = 1; i <= 20; ++i)
+        drag.append({ ReplayStep::Move, 0, QPoint(150 + 3 * i, 100 + 2 * i) });
+    drag.append({ ReplayStep::Release, 0, QPoint(210, 140) });
+    QVector<QRect> expected = initialGeometries();
+    expected[0] = QRect(160, 140, 300, 200);
+    QTest::newRow("caption drag") << drag << expected << false;
+
+    ReplayTrace right = { { ReplayStep::Hover, 0, QPoint(298, 100) }, { ReplayStep::Press, 0, QPoint(298, 100) } };
+    for (int i = 1; i <= 10; ++i)
+        right.append({ ReplayStep::Move, 0, QPoint(298 + 5 * i, 100) });
+    right.append({ ReplayStep::Release, 0, QPoint(348, 100) });
+    expected = initialGeometries();
+    expected[0] = QRect(100, 100, 348, 200);
+    QTest::newRow("right edge resize") << right << expected << false;
+
+    ReplayTrace topLeft = { { ReplayStep::Hover, 1, QPoint(1, 1) }, { ReplayStep::Press, 1, QPoint(1, 1) } };
+    for (int i = 1; i <= 10; ++i)
+        topLeft.append({ ReplayStep::Move, 1, QPoint(1 - 4 * i, 1 + 3 * i) });
+    topLeft.append({ ReplayStep::Release, 1, QPoint(-39, 31) });
+    expected = initialGeometries();
+    expected[1] = QRect(QPoint(121, 171), initialGeometry(1).bottomRight());
+    QTest::newRow("top-left corner resize") << topLeft << expected << false;
+
+    // window 0 is dragged while window 1 is resized, one step of each in turn
+    ReplayTrace both = { { ReplayStep::Hover, 0, QPoint(150, 100) }, { ReplayStep::Hover, 1, QPoint(298, 100) },
+                         { ReplayStep::Press, 0, QPoint(150, 100) }, { ReplayStep::Press, 1, QPoint(298, 100) } };
+    for (int i = 1; i <= 10; ++i) {
+        both.append({ ReplayStep::Move, 0, QPoint(150 - 4 * i, 100 + 3 * i) });
+        both.append({ ReplayStep::Move, 1, QPoint(298 + 5 * i, 100) });
+    }
+    both.append({ ReplayStep::Release, 1, QPoint(348, 100) });
+    both.append({ ReplayStep::Release, 0, QPoint(110, 130) });
+    expected = initialGeometries();
+    expected[0] = QRect(60, 130, 300, 200);
+    expected[1] = QRect(160, 140, 348, 200);
+    QTest::newRow("drag and resize together") << both << expected << true;
+
+    const ReplayTrace borders = {
+        { ReplayStep::Hover, 2, QPoint(150, 100) },
+        { ReplayStep::Hover, 2, QPoint(1, 100) },
+        { ReplayStep::Hover, 2, QPoint(1, 198) },
+        { ReplayStep::Hover, 2, QPoint(150, 198) },
+        { ReplayStep::Hover, 2, QPoint(298, 1) },
+        { ReplayStep::Leave, 2, QPoint() },
+        { ReplayStep::Hover, 3, QPoint(298, 100) }
+    };
+    QTest::newRow("hover borders across windows") << borders << initialGeometries() << false;
+
+    const ReplayTrace click = {
+        { ReplayStep::Hover, 0, QPoint(150, 100) },
+        { ReplayStep::Press, 0, QPoint(150, 100) },
+        { ReplayStep::Release, 0, QPoint(150, 100) }
+    };
+    QTest::newRow("caption click") << click << initialGeometries() << false;
+
+    // far more moves than the event and command rings hold, without a pause
+    ReplayTrace longDrag = { { ReplayStep::Hover, 0, QPoint(150, 100) }, { ReplayStep::Press, 0, QPoint(150, 100) } };
+    for (int i = 1; i <= 3000; ++i)
+        longDrag.append({ ReplayStep::Move, 0, QPoint(150 + i % 97, 100 + i % 53) });
+    longDrag.append({ ReplayStep::Release, 0, QPoint(150 + 3000 % 97, 100 + 3000 % 53) });
+    expected = initialGeometries();
+    expected[0] = QRect(100 + 3000 % 97, 100 + 3000 % 53, 300, 200);
+    QTest::newRow("long drag") << longDrag << expected << false;
+
+    // every window overruns its rings at once, the pool serves all of them
+    const ReplayTrace drags = concurrentDrags(3000, &expected);
+    QTest::newRow("long drags on every window") << drags << expected << true;
+
+    for (quint32 seed = 1; seed <= 16; ++seed) {
+        const ReplayTrace trace = randomTrace(seed, &expected);
+        QTest::newRow(qPrintable(QStringLiteral("random %1").arg(seed))) << trace << expected << true;
+    }
+}
+
+// every policy ends each window on the rect worked out for it; the override
+// cursor is application wide, windows racing for it are left out, otherwise
+// the workers leave the one the inline policy leaves
+void TestFramelessReplay::replay()
+{
+    QFETCH(ReplayTrace, trace);
+    QFETCH(QVector<QRect>, expected);
+    QFETCH(bool, interleaved);
+
+    int referenceCursor = -1;
+    for (Frameless::ExecutionPolicy policy : { Frameless::ExecutionPolicy::Inline,
+                                               Frameless::ExecutionPolicy::SharedWorker,
+                                               Frameless::ExecutionPolicy::DedicatedWorker }) {
+        const ReplayResult result = replayTrace(trace, policy);
+        if (QTest::currentTestFailed())
+            return;
+
+        for (int i = 0; i < ReplayWindows; ++i)
+            QCOMPARE(result.geometries.at(i), expected.at(i));
+
+        if (interleaved)
+            continue;
+        if (policy == Frameless::ExecutionPolicy::Inline) {
+            referenceCursor = result.cursorShape;
+        } else {
+            QCOMPARE(result.cursorShape, referenceCursor);
+        }
+    }
+}
+
+void TestFramelessReplay::restoreAfterNativeMove_data()
+{
+    QTest::addColumn<Frameless::ExecutionPolicy>("policy");
+
+    QTest::newRow("inline") << Frameless::ExecutionPolicy::Inline;
+    QTest::newRow("shared worker") << Frameless::ExecutionPolicy::SharedWorker;
+    QTest::newRow("dedicated worker") << Frameless::ExecutionPolicy::DedicatedWorker;
+}
+
+// a native move must not leave its bit behind for the next drag, which on
+// a maximized window restores it
+void TestFramelessReplay::restoreAfterNativeMove()
+{
+    QFETCH(Frameless::ExecutionPolicy, policy);
+
+    ReplayWindow window(policy);
+    window.setGeometry(initialGeometry(0));
+    window.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&window));
+    Frameless *frameless = window.frameless();
+
+    auto send = [&window](QEvent::Type type, const QPoint &globalPos) {
+        const QPoint localPos = window.mapFromGlobal(globalPos);
+        if (type == QEvent::HoverMove) {
+            QHoverEvent event(type, localPos, localPos);
+            QCoreApplication::sendEvent(&window, &event);
+            return;
+        }
+
+        const Qt::MouseButton button = type == QEvent::MouseMove ? Qt::NoButton : Qt::LeftButton;
+        const Qt::MouseButtons buttons = type == QEvent::MouseButtonRelease ? Qt::NoButton : Qt::LeftButton;
+        QMouseEvent event(type, localPos, globalPos, button, buttons, Qt::NoModifier);
+        QCoreApplication::sendEvent(&window, &event);
+    };
+
+    QPoint caption = window.mapToGlobal(QPoint(150, 100));
+    send(QEvent::HoverMove, caption);
+    send(QEvent::MouseButtonPress, caption);
+    frameless->waitForWorker();
+
+    // offscreen refuses native moves, stand in for a window manager that took it
+    frameless->setAcceptSystemMoving(true);
+    send(QEvent::MouseButtonRelease, caption);
+    frameless->waitForWorker();
+    QVERIFY(!frameless->acceptSystemMoving());
+
+    window.showMaximized();
+    QTRY_VERIFY(window.isMaximized());
+    QCoreApplication::processEvents();
+
+    caption = window.mapToGlobal(QPoint(150, 100));
+    send(QEvent::HoverMove, caption);
+    send(QEvent::MouseButtonPress, caption);
+    for (int i = 1; i <= 10; ++i)
+        send(QEvent::MouseMove, caption + QPoint(5 * i, 3 * i));
+    send(QEvent::MouseButtonRelease, caption + QPoint(50, 30));
+    frameless->waitForWorker();
+
+    QTRY_VERIFY(!window.isMaximized());
+    QCOMPARE(window.size(), initialGeometry(0).size());
+
+    while (QApplication::overrideCursor())
+        QApplication::restoreOverrideCursor();
+}
+
+ReplayResult TestFramelessReplay::replayTrace(const ReplayTrace &trace, Frameless::ExecutionPolicy policy)
+{
+    QVector<ReplayWindow *> windows;
+    for (int i = 0; i < ReplayWindows; ++i) {
+        ReplayWindow *window = new ReplayWindow(policy);
+        window->setGeometry(initialGeometry(i));
+        window->show();
+        windows.append(window);
+    }
+
+    ReplayResult result;
+    for (ReplayWindow *window : qAsConst(windows)) {
+        if (!QTest::qWaitForWindowExposed(window)) {
+            qDeleteAll(windows);
+            QTest::qFail("window not exposed", __FILE__, __LINE__);
+            return result;
+        }
+    }
+
+    // a window's next gesture only starts once its previous one has landed,
+    // as it does for a person; the other windows keep their work in flight
+    auto settle = [](ReplayWindow *window) {
+        window->frameless()->waitForWorker();
+        QCoreApplication::processEvents();
+    };
+
+    QVector<bool> pressed(windows.size(), false);
+    QVector<bool> landed(windows.size(), true);
+    for (const ReplayStep &step : trace) {
+        ReplayWindow *window = windows.at(step.window);
+        if (!landed.at(step.window)) {
+            settle(window);
+            landed[step.window] = true;
+        }
+
+        const QPoint globalPos = initialGeometry(step.window).topLeft() + step.pos;
+        const QPoint localPos = window->mapFromGlobal(globalPos);
+        switch (step.type) {
+        case ReplayStep::Hover: {
+            QHoverEvent event(QEvent::HoverMove, localPos, localPos);
+            QCoreApplication::sendEvent(window, &event);
+        }
+            break;
+        case ReplayStep::Press: {
+            QMouseEvent event(QEvent::MouseButtonPress, localPos, globalPos, Qt::LeftButton, Qt::LeftButton, Qt::NoModifier);
+            QCoreApplication::sendEvent(window, &event);
+            pressed[step.window] = true;
+        }
+            break;
+        case ReplayStep::Move: {
+            QMouseEvent event(QEvent::MouseMove, localPos, globalPos, Qt::NoButton,
+                              pressed.at(step.window) ? Qt::LeftButton : Qt::NoButton, Qt::NoModifier);
+            QCoreApplication::sendEvent(window, &event);
+        }
+            break;
+        case ReplayStep::Release: {
+            QMouseEvent event(QEvent::MouseButtonRelease, localPos, globalPos, Qt::LeftButton, Qt::NoButton, Qt::NoModifier);
+            QCoreApplication::sendEvent(window, &event);
+            pressed[step.window] = false;
+            landed[step.window] = false;
+        }
+            break;
+        case ReplayStep::Leave: {
+            QEvent event(QEvent::Leave);
+            QCoreApplication::sendEvent(window, &event);
+            landed[step.window] = false;
+        }
+            break;
+        }
+    }
+
+    for (ReplayWindow *window : qAsConst(windows))
+        settle(window);
+
+    for (ReplayWindow *window : qAsConst(windows))
+        result.geometries.append(window->geometry());
+    if (QCursor *cursor = QApplication::overrideCursor())
+        result.cursorShape = int(cursor->shape());
+
+    // the override cursor is application wide, the next replay starts clean
+    qDeleteAll(windows);
+    while (QApplication::overrideCursor())
+        QApplication::restoreOverrideCursor();
+
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    // no display needed, and every run sees the same screen
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QApplication app(argc, argv);
+    TestFramelessReplay test;
+
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "tst_framelessreplay.moc"
@@ -0,0 +1,20 @@
+QT += testlib
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_framelessreplay
+
+# qmake CONFIG+=tsan runs the worker rows under ThreadSanitizer, reports are
+# only free of noise from Qt's own locks against a Qt built with -sanitize thread
+tsan {
+    QMAKE_CXXFLAGS += -fsanitize=thread -fno-omit-frame-pointer
+    QMAKE_LFLAGS += -fsanitize=thread
+}
+
+# no application around, build against the stand-in headers
+CONFIG += frameless_stubs
+include(../../frameless.pri)
+
+SOURCES += \
+    tst_framelessreplay.cpp